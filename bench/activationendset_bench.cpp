@@ -0,0 +1,159 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <boost/unordered/unordered_flat_set.hpp>
+
+#include "activationendset.hpp"
+
+namespace {
+// The hash set version of ActivationEndSet that the bitset version replaced,
+// kept here as a baseline.
+template <typename T> class HashActivationEndSet {
+private:
+    T m_start;
+    T m_end;
+    T m_min_absent_element;
+    boost::unordered_flat_set<T> m_abnormal_elements;
+    boost::unordered_flat_set<T> m_temporary_abnormal_elements;
+
+public:
+    HashActivationEndSet(T start, T end)
+        : m_start {start}
+        , m_end {end}
+        , m_min_absent_element {start}
+    {
+    }
+
+    [[nodiscard]] T lowest_absent_element() const
+    {
+        for (auto element = m_min_absent_element; element < m_end; ++element) {
+            if (!m_temporary_abnormal_elements.contains(element)) {
+                return element;
+            }
+        }
+
+        return m_end;
+    }
+
+    [[nodiscard]] T next_absent_element(T element) const
+    {
+        for (element = std::max(element + 1, m_min_absent_element);
+             element < m_end; ++element) {
+            if (!m_abnormal_elements.contains(element)
+                && !m_temporary_abnormal_elements.contains(element)) {
+                return element;
+            }
+        }
+
+        return m_end;
+    }
+
+    void add(T element)
+    {
+        if (m_min_absent_element == element) {
+            ++m_min_absent_element;
+            while (m_abnormal_elements.contains(m_min_absent_element)) {
+                m_abnormal_elements.erase(m_min_absent_element);
+                ++m_min_absent_element;
+            }
+        } else {
+            m_abnormal_elements.insert(element);
+        }
+    }
+
+    void add_temporary_element(T element)
+    {
+        m_temporary_abnormal_elements.insert(element);
+    }
+
+    void clear_temporary_elements() { m_temporary_abnormal_elements.clear(); }
+};
+
+// Mimics the optimiser's use of the set for one vertex of a chart with
+// point_count points. Each starting point walks the absent act ends within
+// reach, marking most of them attained and some as temporary, with the
+// temporary ones cleared whenever an SP phrase would be gained.
+template <typename Set>
+std::size_t simulate_vertex(int first_point, int point_count)
+{
+    constexpr int ACT_REACH = 400;
+    constexpr int START_COUNT = 40;
+    constexpr int PHRASE_GAP = 7;
+
+    Set set {first_point, point_count};
+    std::size_t visited = 0;
+    for (auto start = first_point;
+         start < std::min(first_point + START_COUNT, point_count); ++start) {
+        const auto reach = std::min(start + ACT_REACH, point_count);
+        for (auto q = set.lowest_absent_element(); q < reach;
+             q = set.next_absent_element(q)) {
+            ++visited;
+            if (q % 11 == 0) {
+                set.add_temporary_element(q);
+            } else if (q < start + ACT_REACH / 2 || q % 3 != 0) {
+                set.add(q);
+            }
+        }
+        if (start % PHRASE_GAP == 0) {
+            set.clear_temporary_elements();
+        }
+    }
+    return visited;
+}
+
+template <typename Set> double time_chart(int point_count, std::size_t& visited)
+{
+    constexpr int VERTEX_STRIDE = 5;
+
+    const auto start_time = std::chrono::steady_clock::now();
+    for (auto first = 0; first < point_count; first += VERTEX_STRIDE) {
+        visited += simulate_vertex<Set>(first, point_count);
+    }
+    const std::chrono::duration<double, std::milli> elapsed
+        = std::chrono::steady_clock::now() - start_time;
+    return elapsed.count();
+}
+}
+
+int main()
+{
+    const std::vector<int> chart_lengths {1000, 5000, 20000};
+
+    std::cout << "Points\tHash (ms)\tBitset (ms)\n";
+    for (auto length : chart_lengths) {
+        std::size_t hash_visited = 0;
+        std::size_t bitset_visited = 0;
+        const auto hash_time
+            = time_chart<HashActivationEndSet<int>>(length, hash_visited);
+        const auto bitset_time
+            = time_chart<ActivationEndSet<int>>(length, bitset_visited);
+        if (hash_visited != bitset_visited) {
+            std::cerr << "Sets visited different act ends\n";
+            return 1;
+        }
+        std::cout << length << '\t' << hash_time << '\t' << bitset_time
+                  << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "pathgraph.hpp"
+
+namespace {
+// Each point of the synthetic chart has this many vertices, standing in for
+// the SP bar and whammy states an activation can start from.
+constexpr int STATES_PER_POINT = 8;
+
+struct Edge {
+    int dest_vertex;
+    int weight;
+    std::vector<int> activations;
+};
+
+// Mimics a chart where an activation from a point can end at any of the next
+// ACT_REACH points, leaving one of the states at the point after. Weights are
+// pseudo-random so only a few paths are optimal.
+std::vector<Edge> chart_out_edges(int vertex, int point_count)
+{
+    constexpr int ACT_REACH = 16;
+    constexpr int MAX_WEIGHT = 50;
+
+    const auto point = vertex / STATES_PER_POINT;
+    const auto state = vertex % STATES_PER_POINT;
+    std::vector<Edge> edges;
+    for (auto distance = 1; distance <= ACT_REACH; ++distance) {
+        const auto dest_point = point + distance;
+        if (dest_point >= point_count) {
+            break;
+        }
+        const auto dest_state
+            = (state * 5 + distance + point) % STATES_PER_POINT;
+        const auto weight
+            = (point * 31 + distance * 7 + state * 13) % MAX_WEIGHT;
+        edges.push_back(
+            {.dest_vertex = dest_point * STATES_PER_POINT + dest_state,
+             .weight = weight,
+             .activations = {dest_point}});
+    }
+    return edges;
+}
+
+std::optional<std::size_t> peak_resident_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+        == 0) {
+        return std::nullopt;
+    }
+    return counters.PeakWorkingSetSize;
+#elif defined(__unix__) || defined(__APPLE__)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return std::nullopt;
+    }
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    constexpr std::size_t BYTES_PER_KIB = 1024;
+    return static_cast<std::size_t>(usage.ru_maxrss) * BYTES_PER_KIB;
+#endif
+#else
+    return std::nullopt;
+#endif
+}
+}
+
+// Peak memory is per process, so each run measures one generator:
+// chopt_pathgraph_memory_bench <serial|low-memory|bottom-up> [point count]
+int main(int argc, char** argv)
+{
+    constexpr int DEFAULT_POINT_COUNT = 50000;
+    constexpr std::size_t BYTES_PER_MIB = 1024 * 1024;
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <serial|low-memory|bottom-up> [point count]\n";
+        return 1;
+    }
+    const std::string mode {argv[1]};
+    const auto point_count
+        = argc > 2 ? std::stoi(argv[2]) : DEFAULT_POINT_COUNT;
+    const auto out_edges
+        = [&](int vertex) { return chart_out_edges(vertex, point_count); };
+    const auto point_index = [](int vertex) {
+        return static_cast<std::size_t>(vertex / STATES_PER_POINT);
+    };
+
+    const auto start_time = std::chrono::steady_clock::now();
+    std::optional<PathGraph<int, std::vector<int>>> graph;
+    if (mode == "serial") {
+        graph = generate_optimal_graph<int, std::vector<int>,
+                                       decltype(out_edges)>(0, out_edges);
+    } else if (mode == "low-memory") {
+        graph = generate_optimal_graph_low_memory<int, std::vector<int>,
+                                                  decltype(out_edges),
+                                                  decltype(point_index)>(
+            0, out_edges, point_index);
+    } else if (mode == "bottom-up") {
+        graph = generate_optimal_graph_bottom_up<int, std::vector<int>,
+                                                 decltype(out_edges),
+                                                 decltype(point_index)>(
+            0, out_edges, point_index);
+    } else {
+        std::cerr << "Unknown mode " << mode << '\n';
+        return 1;
+    }
+    const std::chrono::duration<double, std::milli> elapsed
+        = std::chrono::steady_clock::now() - start_time;
+
+    const auto peak_bytes = peak_resident_bytes();
+    std::cout << "Mode\tPoints\tVertices\tValue\tTime (ms)\tPeak RSS (MiB)\n";
+    std::cout << mode << '\t' << point_count << '\t' << graph->vertex_count()
+              << '\t' << *graph->optimal_subpath_value(graph->root_vertex_id())
+              << '\t' << elapsed.count() << '\t';
+    if (peak_bytes.has_value()) {
+        std::cout << *peak_bytes / BYTES_PER_MIB << '\n';
+    } else {
+        std::cout << "unknown\n";
+    }
+    return 0;
+}
@@ -58,6 +58,7 @@ JsonSettings load_saved_settings(std::string_view application_dir)
 {
     constexpr int MAX_LINE_EDIT_INT = 999999999;
     constexpr int MAX_PERCENT = 100;
+    constexpr int MAX_THREADS = 1024;
     constexpr int MAX_VIDEO_LAG = 200;
     constexpr int MIN_VIDEO_LAG = -200;
 
@@ -67,6 +68,7 @@ JsonSettings load_saved_settings(std::string_view application_dir)
     settings.lazy_whammy = 0;
     settings.whammy_delay = 0;
     settings.video_lag = 0;
+    settings.threads = 1;
     settings.is_lefty_flip = false;
 
     QFile settings_file {settings_path(application_dir)};
@@ -91,6 +93,8 @@ JsonSettings load_saved_settings(std::string_view application_dir)
                                        {.min = 0, .max = MAX_LINE_EDIT_INT}, 0);
     settings.video_lag = read_value(
         obj, "video_lag", {.min = MIN_VIDEO_LAG, .max = MAX_VIDEO_LAG}, 0);
+    settings.threads
+        = read_value(obj, "threads", {.min = 1, .max = MAX_THREADS}, 1);
     settings.is_lefty_flip = read_json_bool(obj, "lefty_flip", false);
 
     return settings;
@@ -104,6 +108,7 @@ void save_settings(const JsonSettings& settings,
                              {"lazy_whammy", settings.lazy_whammy},
                              {"whammy_delay", settings.whammy_delay},
                              {"video_lag", settings.video_lag},
+                             {"threads", settings.threads},
                              {"lefty_flip", settings.is_lefty_flip}};
     QFile settings_file {settings_path(application_dir)};
     if (settings_file.open(QIODevice::WriteOnly)) {
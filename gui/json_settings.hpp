@@ -27,6 +27,7 @@ struct JsonSettings {
     int lazy_whammy;
     int whammy_delay;
     int video_lag;
+    int threads;
     bool is_lefty_flip;
 };
 
@@ -27,6 +27,7 @@
 #include <QtSystemDetection>
 
 #include "image.hpp"
+#include "imagebuilder.hpp"
 #include "json_settings.hpp"
 #include "mainwindow.hpp"
 #include "ui_mainwindow.h"
@@ -100,25 +101,28 @@ class OptimiserThread : public QThread {
     Q_OBJECT
 
 private:
-    std::atomic<bool> m_terminate = false;
+    const std::atomic<bool>* m_terminate = nullptr;
     Settings m_settings;
+    std::unique_ptr<PathingSession> m_session;
     std::optional<SightRead::Song> m_song;
     QString m_file_name;
 
 protected:
     void run() override
     {
-        if (!m_song.has_value()) {
+        if (m_session == nullptr && !m_song.has_value()) {
             throw std::runtime_error("m_song missing value");
         }
 
         try {
-            const auto& track
-                = m_song->track(m_settings.instrument, m_settings.difficulty);
-            const auto builder = make_builder(
-                *m_song, track, m_settings,
+            if (m_session == nullptr) {
+                m_session = std::make_unique<PathingSession>(
+                    std::move(*m_song), m_settings, m_terminate);
+            }
+            const auto builder = m_session->make_builder(
+                m_settings,
                 [&](const QString& text) { emit write_text(text); },
-                &m_terminate);
+                [&](int percent) { emit progress_changed(percent); });
             emit write_text("Saving image...");
             const Image image {builder};
             image.save(m_file_name.toStdString().c_str());
@@ -135,18 +139,33 @@ public:
     {
     }
 
-    void set_data(Settings settings, SightRead::Song song,
-                  const QString& file_name)
+    void set_data(Settings settings, const QString& file_name,
+                  const std::atomic<bool>* terminate)
     {
         m_settings = std::move(settings);
-        m_song = std::move(song);
         m_file_name = file_name;
+        m_terminate = terminate;
+    }
+
+    // The thread either reuses a session from an earlier search or makes a
+    // new one from a song.
+    void set_session(std::unique_ptr<PathingSession> session)
+    {
+        m_session = std::move(session);
     }
 
-    void end_thread() { m_terminate = true; }
+    void set_song(SightRead::Song song) { m_song = std::move(song); }
+
+    std::unique_ptr<PathingSession> take_session()
+    {
+        return std::move(m_session);
+    }
 
 signals:
     void write_text(const QString& text);
+    // Emitted from the search's threads with how far through the song the
+    // search has got, as a percentage.
+    void progress_changed(int percent);
 };
 
 void restore_combo_box_value(QComboBox& combo_box, const QVariant& value,
@@ -189,6 +208,8 @@ MainWindow::MainWindow(QWidget* parent)
         new QIntValidator(0, MAX_DIGITS_INT, m_ui->whammyDelayLineEdit));
     m_ui->speedLineEdit->setValidator(
         new QIntValidator(MIN_SPEED, MAX_SPEED, m_ui->speedLineEdit));
+    m_ui->threadsLineEdit->setValidator(
+        new QIntValidator(1, MAX_THREADS, m_ui->threadsLineEdit));
 
     m_ui->squeezeLabel->setMinimumWidth(MIN_LABEL_WIDTH);
     m_ui->earlyWhammyLabel->setMinimumWidth(MIN_LABEL_WIDTH);
@@ -202,6 +223,7 @@ MainWindow::MainWindow(QWidget* parent)
     m_ui->lazyWhammyLineEdit->setText(QString::number(settings.lazy_whammy));
     m_ui->whammyDelayLineEdit->setText(QString::number(settings.whammy_delay));
     m_ui->videoLagSlider->setValue(settings.video_lag);
+    m_ui->threadsLineEdit->setText(QString::number(settings.threads));
     m_ui->leftyCheckBox->setChecked(settings.is_lefty_flip);
 
     setAcceptDrops(true);
@@ -209,8 +231,6 @@ MainWindow::MainWindow(QWidget* parent)
 
 MainWindow::~MainWindow()
 {
-    constexpr auto DELAY_IN_MS = 5000;
-
     JsonSettings settings {};
     settings.squeeze = m_ui->squeezeSlider->value();
     settings.early_whammy = m_ui->earlyWhammySlider->value();
@@ -232,23 +252,23 @@ MainWindow::~MainWindow()
     } else {
         settings.whammy_delay = 0;
     }
+    const auto threads_text = m_ui->threadsLineEdit->text();
+    const auto threads = threads_text.toInt(&ok);
+    if (ok) {
+        settings.threads = threads;
+    } else {
+        settings.threads = 1;
+    }
 
     save_settings(settings,
                   QCoreApplication::applicationDirPath().toStdString());
 
+    // The search checks m_terminate between each vertex and activation, so
+    // it stops soon after it is set.
+    m_terminate = true;
     if (m_thread != nullptr) {
-        auto* opt_thread = dynamic_cast<OptimiserThread*>(m_thread.get());
-        if (opt_thread != nullptr) {
-            opt_thread->end_thread();
-        }
         m_thread->quit();
-        // We give the thread 5 seconds to obey, then kill it. Although all
-        // the thread does apart from CPU-bound work is write to a file at
-        // the very end, so the call to terminate is not so bad.
-        if (!m_thread->wait(DELAY_IN_MS)) {
-            m_thread->terminate();
-            m_thread->wait();
-        }
+        m_thread->wait();
     }
 }
 
@@ -285,6 +305,7 @@ Settings MainWindow::get_settings() const
     Settings settings;
 
     settings.blank = m_ui->blankPathCheckBox->isChecked();
+    settings.score_only = false;
     settings.draw_bpms = m_ui->drawBpmsCheckBox->isChecked();
     settings.draw_solos = m_ui->drawSolosCheckBox->isChecked();
     settings.draw_time_sigs = m_ui->drawTsesCheckBox->isChecked();
@@ -339,6 +360,15 @@ Settings MainWindow::get_settings() const
         settings.speed = DEFAULT_SPEED;
     }
 
+    const auto threads_text = m_ui->threadsLineEdit->text();
+    const auto threads = threads_text.toInt(&ok);
+    if (ok && threads >= 1) {
+        settings.optimiser_settings.thread_count
+            = static_cast<unsigned int>(threads);
+    } else {
+        settings.optimiser_settings.thread_count = 1;
+    }
+
     return settings;
 }
 
@@ -428,15 +458,27 @@ void MainWindow::on_findPathButton_clicked()
         return;
     }
 
+    // A new song must not be loaded while the search is using the old one.
     m_ui->selectFileButton->setEnabled(false);
     m_ui->findPathButton->setEnabled(false);
+    setAcceptDrops(false);
+    m_ui->progressBar->setValue(0);
 
+    // Only the timing settings change between most searches, so the song
+    // processed for the last one is kept and given the new settings.
     auto settings = get_settings();
-    auto song = m_loaded_file->load_song(settings.game);
     auto worker_thread = std::make_unique<OptimiserThread>(this);
-    worker_thread->set_data(std::move(settings), std::move(song), file_name);
+    if (m_session != nullptr && m_session->can_find_path_for(settings)) {
+        worker_thread->set_session(std::move(m_session));
+    } else {
+        m_session.reset();
+        worker_thread->set_song(m_loaded_file->load_song(settings.game));
+    }
+    worker_thread->set_data(std::move(settings), file_name, &m_terminate);
     connect(worker_thread.get(), &OptimiserThread::write_text, this,
             &MainWindow::write_message);
+    connect(worker_thread.get(), &OptimiserThread::progress_changed,
+            m_ui->progressBar, &QProgressBar::setValue);
     connect(worker_thread.get(), &OptimiserThread::finished, this,
             &MainWindow::path_found);
     connect(worker_thread.get(), &OptimiserThread::finished, this,
@@ -457,6 +499,7 @@ void MainWindow::song_read(SongFile loaded_file, const std::set<Game>& games,
 {
     m_thread.reset();
     m_loaded_file = std::move(loaded_file);
+    m_session.reset();
 
     populate_games(games);
 
@@ -472,9 +515,15 @@ void MainWindow::song_read(SongFile loaded_file, const std::set<Game>& games,
 
 void MainWindow::path_found()
 {
+    auto* opt_thread = dynamic_cast<OptimiserThread*>(m_thread.get());
+    if (opt_thread != nullptr) {
+        m_session = opt_thread->take_session();
+    }
     m_thread.reset();
+    m_ui->progressBar->reset();
     m_ui->selectFileButton->setEnabled(true);
     m_ui->findPathButton->setEnabled(true);
+    setAcceptDrops(true);
 }
 
 void MainWindow::on_engineComboBox_currentIndexChanged(int index)
@@ -19,6 +19,7 @@
 #ifndef CHOPT_MAINWINDOW_HPP
 #define CHOPT_MAINWINDOW_HPP
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <set>
@@ -36,18 +37,25 @@ namespace Ui {
 class MainWindow;
 }
 
+class PathingSession;
+
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
 private:
     std::unique_ptr<Ui::MainWindow> m_ui;
     std::optional<SongFile> m_loaded_file;
+    std::atomic<bool> m_terminate = false;
+    // The song processed for the last search, kept while the song and
+    // everything but the timing settings stay the same.
+    std::unique_ptr<PathingSession> m_session;
     std::unique_ptr<QThread> m_thread;
     Settings get_settings() const;
     void load_file(const QString& file_name);
     void populate_games(const std::set<Game>& games);
     static constexpr int MAX_SPEED = 5000;
     static constexpr int MIN_SPEED = 5;
+    static constexpr int MAX_THREADS = 1024;
 
 protected:
     void dragEnterEvent(QDragEnterEvent* event) override;
@@ -19,40 +19,109 @@
 #ifndef CHOPT_ACTIVATIONENDSET_HPP
 #define CHOPT_ACTIVATIONENDSET_HPP
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <vector>
 
-#include <boost/unordered/unordered_flat_set.hpp>
-
-// This set behaves like two hash sets. One contains permanent elements, the
-// second contains temporary elements that can be cleared as desired. The use of
-// this data structure is to keep track of already attained activation ends in
-// the optimiser to avoid recalculating activations that are completely
-// redundant. The temporary elements are needed for end points that can be
-// discounted only until another SP phrase is acquired. For instance, the first
-// act of the GH:VH Expert guitar chart of Somebody Get Me A Doctor requires the
-// player to stop whammying before getting half bar, and waiting until the
-// second phrase is acquired before activating.
+// This set behaves like two sets. One contains permanent elements, the second
+// contains temporary elements that can be cleared as desired. The use of this
+// data structure is to keep track of already attained activation ends in the
+// optimiser to avoid recalculating activations that are completely redundant.
+// The temporary elements are needed for end points that can be discounted only
+// until another SP phrase is acquired. For instance, the first act of the
+// GH:VH Expert guitar chart of Somebody Get Me A Doctor requires the player to
+// stop whammying before getting half bar, and waiting until the second phrase
+// is acquired before activating.
 //
-// This class is seen as a pair of subsets of a range [a, b). The key
-// optimisation that makes this class useful is that for the optimiser's uses,
-// the subset is typically of the form [a, c) and a very low number of extra
-// elements after c. Thus by storing c, we can dramatically reduce the size of
-// the contained hash sets.
+// This class is seen as a pair of subsets of a range [a, b), each stored as a
+// bitset over the range. For the optimiser's uses, the subset is typically of
+// the form [a, c) and a very low number of extra elements after c, so c is
+// stored to answer most queries without touching the bitsets. Searches for
+// absent elements skip a whole word of present elements at a time.
+//
+// The bitsets allocate from the memory resource passed to the constructor,
+// which lets the optimiser keep them in a per-thread Arena.
 template <typename T> class ActivationEndSet {
 private:
+    using Word = std::uint64_t;
+    using Words = std::pmr::vector<Word>;
+
+    static constexpr std::size_t WORD_BITS = 64;
+
     T m_start;
     T m_end;
     T m_min_absent_element;
-    boost::unordered_flat_set<T> m_abnormal_elements;
-    boost::unordered_flat_set<T> m_temporary_abnormal_elements;
+    Words m_permanent_words;
+    Words m_temporary_words;
+    std::size_t m_first_temporary_word;
+    std::size_t m_last_temporary_word {0};
+
+    [[nodiscard]] std::size_t index(T element) const
+    {
+        return static_cast<std::size_t>(element - m_start);
+    }
+
+    [[nodiscard]] T element(std::size_t index) const
+    {
+        return static_cast<T>(m_start + static_cast<std::ptrdiff_t>(index));
+    }
+
+    [[nodiscard]] std::size_t size() const { return index(m_end); }
+
+    [[nodiscard]] static bool test(const Words& words, std::size_t index)
+    {
+        return (words[index / WORD_BITS] >> (index % WORD_BITS) & 1U) != 0;
+    }
+
+    static void set(Words& words, std::size_t index)
+    {
+        words[index / WORD_BITS] |= Word {1} << (index % WORD_BITS);
+    }
+
+    // Returns the first index from first onwards that is clear in every one of
+    // words_list, or size() if there is none.
+    template <typename... W>
+    [[nodiscard]] std::size_t first_clear_index(std::size_t first,
+                                                const W&... words_list) const
+    {
+        if (first >= size()) {
+            return size();
+        }
+        auto word_index = first / WORD_BITS;
+        auto absent_bits = ~(words_list[word_index] | ...);
+        absent_bits &= ~Word {0} << (first % WORD_BITS);
+        while (absent_bits == 0) {
+            ++word_index;
+            if (word_index * WORD_BITS >= size()) {
+                return size();
+            }
+            absent_bits = ~(words_list[word_index] | ...);
+        }
+        const auto result = word_index * WORD_BITS
+            + static_cast<std::size_t>(std::countr_zero(absent_bits));
+        return std::min(result, size());
+    }
 
 public:
-    ActivationEndSet(T start, T end)
+    ActivationEndSet(T start, T end,
+                     std::pmr::memory_resource* resource
+                     = std::pmr::get_default_resource())
         : m_start {start}
         , m_end {end}
         , m_min_absent_element {start}
+        , m_permanent_words {resource}
+        , m_temporary_words {resource}
     {
         assert(start <= end);
+        const auto word_count = (size() + WORD_BITS - 1) / WORD_BITS;
+        m_permanent_words.resize(word_count, 0);
+        m_temporary_words.resize(word_count, 0);
+        m_first_temporary_word = word_count;
     }
 
     [[nodiscard]] bool contains(T element) const
@@ -63,46 +132,31 @@ public:
         if (element < m_min_absent_element) {
             return true;
         }
-        return m_abnormal_elements.contains(element)
-            || m_temporary_abnormal_elements.contains(element);
+        const auto i = index(element);
+        return test(m_permanent_words, i) || test(m_temporary_words, i);
     }
 
     [[nodiscard]] T lowest_absent_element() const
     {
-        for (auto element = m_min_absent_element; element < m_end; ++element) {
-            if (!m_temporary_abnormal_elements.contains(element)) {
-                return element;
-            }
-        }
-
-        return m_end;
+        return element(
+            first_clear_index(index(m_min_absent_element), m_temporary_words));
     }
 
     [[nodiscard]] T next_absent_element(T element) const
     {
-        for (element = std::max(element + 1, m_min_absent_element);
-             element < m_end; ++element) {
-            if (!m_abnormal_elements.contains(element)
-                && !m_temporary_abnormal_elements.contains(element)) {
-                return element;
-            }
-        }
-
-        return m_end;
+        const auto first = std::max(element + 1, m_min_absent_element);
+        return this->element(first_clear_index(index(first), m_permanent_words,
+                                               m_temporary_words));
     }
 
     void add(T element)
     {
         assert(m_start <= element);
         assert(element < m_end);
+        set(m_permanent_words, index(element));
         if (m_min_absent_element == element) {
-            ++m_min_absent_element;
-            while (m_abnormal_elements.contains(m_min_absent_element)) {
-                m_abnormal_elements.erase(m_min_absent_element);
-                ++m_min_absent_element;
-            }
-        } else {
-            m_abnormal_elements.insert(element);
+            m_min_absent_element = this->element(
+                first_clear_index(index(element), m_permanent_words));
         }
     }
 
@@ -111,10 +165,29 @@ public:
         assert(m_start <= element);
         assert(element < m_end);
 
-        m_temporary_abnormal_elements.insert(element);
+        const auto i = index(element);
+        set(m_temporary_words, i);
+        m_first_temporary_word
+            = std::min(m_first_temporary_word, i / WORD_BITS);
+        m_last_temporary_word = std::max(m_last_temporary_word, i / WORD_BITS);
     }
 
-    void clear_temporary_elements() { m_temporary_abnormal_elements.clear(); }
+    // Only the words that have had temporary elements added are cleared.
+    void clear_temporary_elements()
+    {
+        if (m_first_temporary_word >= m_temporary_words.size()) {
+            return;
+        }
+        const auto first = std::next(
+            m_temporary_words.begin(),
+            static_cast<std::ptrdiff_t>(m_first_temporary_word));
+        const auto last = std::next(
+            m_temporary_words.begin(),
+            static_cast<std::ptrdiff_t>(m_last_temporary_word + 1));
+        std::fill(first, last, 0);
+        m_first_temporary_word = m_temporary_words.size();
+        m_last_temporary_word = 0;
+    }
 };
 
 #endif
@@ -0,0 +1,187 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHOPT_ARENA_HPP
+#define CHOPT_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+// A memory resource for scratch data that is all thrown away at once.
+// Allocations are carved out of large blocks and never freed individually.
+// reset() makes every block available again without returning them to the
+// heap, so an Arena that is reused for similar work stops touching the heap
+// once it has grown large enough. Not thread-safe.
+class Arena : public std::pmr::memory_resource {
+private:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    std::size_t m_block_size;
+    std::vector<Block> m_blocks;
+    std::size_t m_current_block {0};
+    std::size_t m_offset {0};
+    std::size_t m_allocation_count {0};
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++m_allocation_count;
+        while (true) {
+            if (m_current_block == m_blocks.size()) {
+                const auto size = std::max(m_block_size, bytes + alignment);
+                m_blocks.push_back(
+                    {.data = std::make_unique_for_overwrite<std::byte[]>(size),
+                     .size = size});
+            }
+            auto& block = m_blocks[m_current_block];
+            void* ptr = block.data.get() + m_offset;
+            auto space = block.size - m_offset;
+            if (std::align(alignment, bytes, ptr, space) != nullptr) {
+                m_offset = block.size - space + bytes;
+                return ptr;
+            }
+            ++m_current_block;
+            m_offset = 0;
+        }
+    }
+
+    void do_deallocate(void* /*p*/, std::size_t /*bytes*/,
+                       std::size_t /*alignment*/) override
+    {
+    }
+
+    [[nodiscard]] bool
+    do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    explicit Arena(std::size_t block_size = DEFAULT_BLOCK_SIZE)
+        : m_block_size {block_size}
+    {
+    }
+
+    // Frees everything allocated from the arena, keeping the blocks for reuse.
+    void reset()
+    {
+        m_current_block = 0;
+        m_offset = 0;
+    }
+
+    // The number of allocations made from the arena over its whole lifetime.
+    [[nodiscard]] std::size_t allocation_count() const
+    {
+        return m_allocation_count;
+    }
+
+    // The number of blocks the arena has taken from the heap.
+    [[nodiscard]] std::size_t block_count() const { return m_blocks.size(); }
+};
+
+// Arenas for the threads of a single search. Each lease hands out an arena
+// that no other thread is using, and returns it to the pool when it ends, so
+// a search needs about one arena per thread however many vertices it expands.
+// Every arena is freed along with the pool. Thread-safe.
+class ArenaPool {
+private:
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Arena>> m_arenas;
+    std::vector<Arena*> m_free_arenas;
+
+public:
+    class Lease {
+    private:
+        ArenaPool* m_pool;
+        Arena* m_arena;
+
+    public:
+        Lease(ArenaPool& pool, Arena& arena)
+            : m_pool {&pool}
+            , m_arena {&arena}
+        {
+        }
+
+        Lease(const Lease&) = delete;
+        Lease(Lease&&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        ~Lease()
+        {
+            const std::scoped_lock lock {m_pool->m_mutex};
+            m_pool->m_free_arenas.push_back(m_arena);
+        }
+
+        [[nodiscard]] Arena& arena() const { return *m_arena; }
+    };
+
+    // The arena is reset before it is handed out.
+    [[nodiscard]] Lease lease()
+    {
+        const std::scoped_lock lock {m_mutex};
+        if (m_free_arenas.empty()) {
+            m_arenas.push_back(std::make_unique<Arena>());
+            m_free_arenas.push_back(m_arenas.back().get());
+        }
+        auto* arena = m_free_arenas.back();
+        m_free_arenas.pop_back();
+        arena->reset();
+        return {*this, *arena};
+    }
+
+    // The number of arenas the pool has made.
+    [[nodiscard]] std::size_t arena_count()
+    {
+        const std::scoped_lock lock {m_mutex};
+        return m_arenas.size();
+    }
+
+    // The total allocation count of every arena in the pool.
+    [[nodiscard]] std::size_t allocation_count()
+    {
+        const std::scoped_lock lock {m_mutex};
+        std::size_t count = 0;
+        for (const auto& arena : m_arenas) {
+            count += arena->allocation_count();
+        }
+        return count;
+    }
+
+    // The total block count of every arena in the pool.
+    [[nodiscard]] std::size_t block_count()
+    {
+        const std::scoped_lock lock {m_mutex};
+        std::size_t count = 0;
+        for (const auto& arena : m_arenas) {
+            count += arena->block_count();
+        }
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHOPT_CANDIDATECACHE_HPP
+#define CHOPT_CANDIDATECACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/unordered/unordered_flat_map.hpp>
+
+#include "processed.hpp"
+
+// The inputs of an ActivationCandidate in a form that can be hashed. Doubles
+// are rounded to the nearest multiple of TOLERANCE, so candidates that only
+// differ by floating point noise from being worked out along different paths
+// share a key, and -0.0 and 0.0 do too. A cached result may therefore be
+// reused for a candidate whose position or SP differs by up to TOLERANCE.
+struct CandidateKey {
+    static constexpr double TOLERANCE = 1e-9;
+
+    PointPtr act_start;
+    PointPtr act_end;
+    std::int64_t beat_steps;
+    std::int64_t sp_measure_steps;
+    std::int64_t sp_min_steps;
+    std::int64_t sp_max_steps;
+
+    static CandidateKey make(const ActivationCandidate& candidate)
+    {
+        // Infinite values are kept by their bits, which no rounded finite
+        // value of a song's positions or SP comes near.
+        const auto steps = [](double value) {
+            if (!std::isfinite(value)) {
+                return std::bit_cast<std::int64_t>(value);
+            }
+            return static_cast<std::int64_t>(std::llround(value / TOLERANCE));
+        };
+        const auto& position = candidate.earliest_activation_point;
+        return {.act_start = candidate.act_start,
+                .act_end = candidate.act_end,
+                .beat_steps = steps(position.beat.value()),
+                .sp_measure_steps = steps(position.sp_measure.value()),
+                .sp_min_steps = steps(candidate.sp_bar.min()),
+                .sp_max_steps = steps(candidate.sp_bar.max())};
+    }
+
+    [[nodiscard]] bool operator==(const CandidateKey& rhs) const = default;
+};
+
+struct CandidateKeyHash {
+    std::size_t operator()(const CandidateKey& key) const
+    {
+        std::size_t seed = 0;
+        boost::hash_combine(seed, key.act_start);
+        boost::hash_combine(seed, key.act_end);
+        boost::hash_combine(seed, key.beat_steps);
+        boost::hash_combine(seed, key.sp_measure_steps);
+        boost::hash_combine(seed, key.sp_min_steps);
+        boost::hash_combine(seed, key.sp_max_steps);
+        return seed;
+    }
+};
+
+// Remembers the results of ProcessedSong::is_candidate_valid with the default
+// squeeze and whammy requirement, which the optimiser asks for with the same
+// candidate from many vertices. The cache can be used from multiple threads at
+// once, and is split into shards with their own locks like
+// ConcurrentVertexTable. Once the cache holds as many results as its size
+// allows, going by ENTRY_BYTES, further results are not stored.
+class CandidateCache {
+private:
+    static constexpr int SHARD_BITS = 4;
+    static constexpr std::size_t SHARD_COUNT = std::size_t {1} << SHARD_BITS;
+    static constexpr std::size_t SHARD_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+    struct Shard {
+        std::mutex mutex;
+        boost::unordered_flat_map<CandidateKey, ActResult, CandidateKeyHash>
+            results;
+    };
+
+    std::array<Shard, SHARD_COUNT> m_shards;
+    std::size_t m_max_shard_entries;
+    std::atomic<std::size_t> m_hits {0};
+    std::atomic<std::size_t> m_misses {0};
+
+    Shard& shard(const CandidateKey& key)
+    {
+        const auto hash = CandidateKeyHash {}(key) * SHARD_MULTIPLIER;
+        return m_shards.at(hash >> (sizeof(std::size_t) * 8 - SHARD_BITS));
+    }
+
+public:
+    // An estimate of the size of a stored result, counting the hash table's
+    // slack. The real size depends on the hash table's load factor.
+    static constexpr std::size_t ENTRY_BYTES
+        = 2 * (sizeof(CandidateKey) + sizeof(ActResult));
+
+    explicit CandidateCache(std::size_t max_bytes)
+        : m_max_shard_entries {max_bytes / ENTRY_BYTES / SHARD_COUNT}
+    {
+    }
+
+    [[nodiscard]] bool is_enabled() const { return m_max_shard_entries > 0; }
+
+    std::optional<ActResult> find(const CandidateKey& key)
+    {
+        auto& key_shard = shard(key);
+        const std::scoped_lock lock {key_shard.mutex};
+        const auto iter = key_shard.results.find(key);
+        if (iter == key_shard.results.end()) {
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return iter->second;
+    }
+
+    void store(const CandidateKey& key, ActResult result)
+    {
+        auto& key_shard = shard(key);
+        const std::scoped_lock lock {key_shard.mutex};
+        if (key_shard.results.size() < m_max_shard_entries) {
+            key_shard.results.emplace(key, result);
+        }
+    }
+
+    [[nodiscard]] std::size_t hits() const { return m_hits; }
+    [[nodiscard]] std::size_t misses() const { return m_misses; }
+
+    [[nodiscard]] std::size_t size()
+    {
+        std::size_t total = 0;
+        for (auto& key_shard : m_shards) {
+            const std::scoped_lock lock {key_shard.mutex};
+            total += key_shard.results.size();
+        }
+        return total;
+    }
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include <functional>
 #include <string>
 #include <tuple>
+#include <typeindex>
 #include <vector>
 
 #include <sightread/drumsettings.hpp>
@@ -31,6 +32,7 @@
 #include <sightread/tempomap.hpp>
 
 #include "engine.hpp"
+#include "optimiser.hpp"
 #include "points.hpp"
 #include "processed.hpp"
 #include "sp.hpp"
@@ -233,4 +235,73 @@ ImageBuilder make_builder(SightRead::Song& song,
                           const std::function<void(const char*)>& write,
                           const std::atomic<bool>* terminate);
 
+// Keeps a song processed for one track, along with its optimiser, so paths
+// can be found again after only the squeeze, early whammy, lazy whammy, video
+// lag or whammy delay change without processing the song again. Settings that
+// only change how the image is drawn are taken from each make_builder call.
+// The optimiser points into the session, so it cannot be copied or moved.
+class PathingSession {
+private:
+    SightRead::Song m_song;
+    SightRead::NoteTrack m_track;
+    SpDurationData m_duration_data;
+    ProcessedSong m_processed_track;
+    Optimiser m_optimiser;
+    Game m_game;
+    SightRead::Instrument m_instrument;
+    SightRead::Difficulty m_difficulty;
+    int m_speed;
+    SightRead::DrumSettings m_drum_settings;
+    std::type_index m_engine_type;
+    OptimiserSettings m_optimiser_settings;
+
+public:
+    PathingSession(SightRead::Song song, const Settings& settings,
+                   const std::atomic<bool>* terminate);
+    PathingSession(const PathingSession&) = delete;
+    PathingSession(PathingSession&&) = delete;
+    PathingSession& operator=(const PathingSession&) = delete;
+    PathingSession& operator=(PathingSession&&) = delete;
+    ~PathingSession() = default;
+
+    // Returns true if settings differ from the ones the session was made with
+    // only in the timing settings and in how the image is drawn.
+    [[nodiscard]] bool can_find_path_for(const Settings& settings) const;
+    // Makes the same builder as make_builder, applying the timing settings in
+    // settings to the kept song first. The search's progress is given to
+    // progress as a percentage, or written with write if progress is empty
+    // and the settings ask for progress reports.
+    // Throws std::invalid_argument if can_find_path_for(settings) is false.
+    ImageBuilder make_builder(const Settings& settings,
+                              const std::function<void(const char*)>& write,
+                              const std::function<void(int)>& progress);
+};
+
+// Makes one builder for each level of settings.squeeze_sweep, in the same
+// order. The song is only parsed and processed once, and the levels are
+// optimised at the same time unless low memory mode is on. The squeeze and
+// early whammy in settings.pathing_settings are changed while the levels are
+// processed and restored afterwards.
+std::vector<ImageBuilder>
+make_squeeze_sweep_builders(SightRead::Song& song,
+                            const SightRead::NoteTrack& track,
+                            Settings& settings,
+                            const std::function<void(const char*)>& write,
+                            const std::atomic<bool>* terminate);
+
+// Returns rough measures of the track used to guess how long it takes to
+// optimise, found from its notes without processing it. Notes stand in for
+// points, SP phrases for SP granting notes, and the fraction of the song
+// covered by sustains for the fraction that can be whammied.
+RuntimeFeatures runtime_features(const SightRead::NoteTrack& track);
+
+// Writes the optimal score and the phrase counts of each activation, without
+// working out the rest of the path or preparing anything for an image. With a
+// time limit, the score of the best path found in time is written instead.
+void write_optimal_score(SightRead::Song& song,
+                         const SightRead::NoteTrack& track,
+                         const Settings& settings,
+                         const std::function<void(const char*)>& write,
+                         const std::atomic<bool>* terminate);
+
 #endif
@@ -20,18 +20,25 @@
 #define CHOPT_OPTIMISER_HPP
 
 #include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
 #include <limits>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
-#include <boost/container_hash/hash.hpp>
-
 #include <sightread/time.hpp>
 
 #include "activationendset.hpp"
+#include "candidatecache.hpp"
 #include "pathgraph.hpp"
 #include "points.hpp"
 #include "processed.hpp"
+#include "settings.hpp"
 
 struct PathGraphVertex {
     PointPtr point = nullptr;
@@ -46,22 +53,63 @@ struct PathGraphVertex {
         == std::tuple {rhs.point, rhs.position.beat.value(),
                        rhs.position.sp_measure.value(), rhs.is_max_sp_vertex};
     }
+};
+
+// PathGraphVertex packed into 16 bytes for use as a hash table key. Points are
+// at least 2-byte aligned, so is_max_sp_vertex is kept in the lowest bit of the
+// point's address. A vertex's SP measure is always derived from its beat, so
+// only the beat is kept, with -0.0 stored as 0.0 so that keys are equal exactly
+// when the vertices are.
+struct PackedVertexKey {
+    std::uintptr_t point_and_flag;
+    std::uint64_t beat_bits;
+
+    [[nodiscard]] bool operator==(const PackedVertexKey& rhs) const = default;
+};
 
-    friend std::size_t hash_value(const PathGraphVertex& vertex)
+struct PackedVertexKeyHash {
+    using is_avalanching = std::true_type;
+
+    std::size_t operator()(const PackedVertexKey& key) const
     {
-        std::size_t seed = 0;
+        constexpr std::uint64_t FIRST_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+        constexpr std::uint64_t SECOND_MULTIPLIER = 0xD6E8FEB86659FD93ULL;
+        constexpr int SHIFT = 32;
 
-        boost::hash_combine(seed, vertex.point);
-        boost::hash_combine(seed, vertex.position.beat.value());
-        boost::hash_combine(seed, vertex.position.sp_measure.value());
-        boost::hash_combine(seed, vertex.is_max_sp_vertex);
+        auto hash = (key.point_and_flag * FIRST_MULTIPLIER) ^ key.beat_bits;
+        hash ^= hash >> SHIFT;
+        hash *= SECOND_MULTIPLIER;
+        hash ^= hash >> SHIFT;
+        return static_cast<std::size_t>(hash);
+    }
+};
 
-        return seed;
+template <> struct VertexKey<PathGraphVertex> {
+    using type = PackedVertexKey;
+    using hasher = PackedVertexKeyHash;
+
+    static PackedVertexKey make(const PathGraphVertex& vertex)
+    {
+        static_assert(alignof(Point) >= 2);
+
+        auto beat = vertex.position.beat.value();
+        if (beat == 0.0) {
+            beat = 0.0;
+        }
+        return {.point_and_flag = reinterpret_cast<std::uintptr_t>(vertex.point)
+                    | static_cast<std::uintptr_t>(vertex.is_max_sp_vertex),
+                .beat_bits = std::bit_cast<std::uint64_t>(beat)};
     }
 };
 
 using OptimiserGraph = PathGraph<PathGraphVertex, std::vector<ProtoActivation>>;
 
+struct AnytimePath {
+    Path path;
+    // False if the search was cut short and path is only the best path found.
+    bool is_optimal;
+};
+
 // The class that stores extra information needed on top of a ProcessedSong
 // for the purposes of optimisation, and finds the optimal path. The song
 // passed to Optimiser's constructor must outlive Optimiser; the class is
@@ -73,12 +121,45 @@ private:
     static constexpr double BASE_DRUM_FILL_DELAY = 2.0 * 100;
     const ProcessedSong* m_song;
     const std::atomic<bool>* m_terminate;
+    OptimiserSettings m_settings;
     SightRead::Second m_drum_fill_delay;
     SightRead::Second m_whammy_delay;
     std::vector<PointPtr> m_next_candidate_points;
+    std::vector<double> m_remaining_phrase_sp;
+    std::function<void(int)> m_progress_callback;
+
+    // Counts of the work done by out_edges for GraphSearchStats. Each call
+    // counts into its own instance, which is then added to the total.
+    struct OutEdgeCounts {
+        std::size_t generated_edges {0};
+        std::size_t max_sp_edges {0};
+        std::size_t successful_candidates {0};
+        std::size_t insufficient_sp_candidates {0};
+        std::size_t surplus_sp_candidates {0};
+        std::size_t skipped_act_ends {0};
+
+        void add(const OutEdgeCounts& other);
+        void write_to(GraphSearchStats& stats) const;
+    };
+
+    void set_next_candidate_points();
 
     // These methods are involved in constructing the OptimiserGraph.
-    [[nodiscard]] OptimiserGraph path_graph(PathGraphVertex root_vertex) const;
+    [[nodiscard]] PathGraphVertex root_vertex() const;
+    [[nodiscard]] Path heuristic_path() const;
+    [[nodiscard]] Path optimal_path(const OptimiserSettings& settings,
+                                    GraphSearchStats* stats) const;
+    // If is_complete is non-null and the search is bounded, the search stops
+    // when cancelled instead of throwing, as generate_optimal_graph_bounded
+    // describes.
+    [[nodiscard]] OptimiserGraph path_graph(PathGraphVertex root_vertex,
+                                            const OptimiserSettings& settings,
+                                            GraphSearchStats& stats,
+                                            int edge_slack = 0,
+                                            bool* is_complete = nullptr) const;
+    [[nodiscard]] int remaining_score_bound(PathGraphVertex vertex) const;
+    [[nodiscard]] std::vector<PathGraphVertex>
+    full_sp_vertices(PathGraphVertex vertex) const;
     [[nodiscard]] PointPtr next_candidate_point(PointPtr point) const;
     [[nodiscard]] PathGraphVertex
     advance_graph_vertex(PathGraphVertex vertex) const;
@@ -86,18 +167,42 @@ private:
     add_whammy_delay(PathGraphVertex vertex) const;
     [[nodiscard]] SightRead::Second
     earliest_fill_appearance(PathGraphVertex vertex) const;
+    // Scratch data that does not outlive the call is allocated from scratch,
+    // while the returned edges are allocated from edge_resource. If terminate
+    // is non-null, OptimisationCancelled is thrown once it is set.
     OutEdgeAggregate<PathGraphVertex, ProtoActivation>
-    out_edges(OptimiserGraph& graph, std::size_t vertex) const;
+    out_edges(PathGraphVertex vertex, std::pmr::memory_resource* scratch,
+              std::pmr::memory_resource* edge_resource, CandidateCache& cache,
+              OutEdgeCounts& counts, const std::atomic<bool>* terminate) const;
+    [[nodiscard]] PointPtr earliest_act_end_point(PointPtr p,
+                                                  SpPosition starting_pos,
+                                                  const SpBar& sp_bar) const;
     void add_acts_from_starting_point(
         PointPtr starting_point, SpPosition starting_pos, SpBar sp_bar,
+        PointPtr earliest_act_end,
         ActivationEndSet<PointPtr>& attained_act_ends,
-        OutEdgeAggregate<PathGraphVertex, ProtoActivation>& optimal_out_edges)
-        const;
+        OutEdgeAggregate<PathGraphVertex, ProtoActivation>& optimal_out_edges,
+        CandidateCache& cache, OutEdgeCounts& counts) const;
+    [[nodiscard]] ActResult
+    cached_candidate_result(const ActivationCandidate& candidate,
+                            CandidateCache& cache,
+                            OutEdgeCounts& counts) const;
 
     // These methods are involved in extracting an optimal path from the
     // OptimiserGraph.
     [[nodiscard]] Path
-    optimal_path_from_graph(const OptimiserGraph& graph) const;
+    optimal_path_from_graph(const OptimiserGraph& graph,
+                            const std::atomic<bool>* terminate) const;
+    [[nodiscard]] Path
+    path_along_edges(const OptimiserGraph& graph,
+                     std::span<const OptimiserGraph::Edge> edges,
+                     const std::atomic<bool>* terminate) const;
+    [[nodiscard]] Activation
+    best_activation(std::span<const ProtoActivation> acts,
+                    PathGraphVertex act_start_vertex,
+                    PathGraphVertex act_end_vertex) const;
+    [[nodiscard]] Path
+    optimal_score_from_graph(const OptimiserGraph& graph) const;
     [[nodiscard]] double act_squeeze_level(ProtoActivation act,
                                            PathGraphVertex vertex) const;
     [[nodiscard]] SpPosition forced_whammy_end(ProtoActivation act,
@@ -112,8 +217,42 @@ private:
 public:
     Optimiser(const ProcessedSong* song, const std::atomic<bool>* terminate,
               int speed, SightRead::Second whammy_delay);
-    // Return the optimal Star Power path.
-    [[nodiscard]] Path optimal_path() const;
+    Optimiser(const ProcessedSong* song, const std::atomic<bool>* terminate,
+              int speed, SightRead::Second whammy_delay,
+              OptimiserSettings settings);
+    // Call after ProcessedSong::apply_timing_settings on the song to update
+    // what the optimiser works out from the song's timing, along with the new
+    // whammy delay. Nothing is kept from earlier searches, so the next search
+    // works from the new settings.
+    void apply_timing_settings(SightRead::Second whammy_delay);
+    // The callback is called from the search's threads with the percentage of
+    // the song's points the furthest expanded vertex has reached, each time
+    // that goes up. The search is depth first, so this climbs quickly at
+    // first and then waits on the rest of the search.
+    void set_progress_callback(std::function<void(int)> callback);
+    // Return the optimal Star Power path. If stats is non-null, it is filled
+    // with counts of the work done by the search.
+    [[nodiscard]] Path optimal_path(GraphSearchStats* stats = nullptr) const;
+    // Return the optimal score boost and the points each activation starts and
+    // ends on, leaving the other members of each Activation at 0. This skips
+    // working out the squeezes and SP bar positions of each activation. Where
+    // several activations give the same score, the first found is used rather
+    // than the one needing the least squeeze, so it may differ from the
+    // activation optimal_path picks.
+    [[nodiscard]] Path optimal_score(GraphSearchStats* stats = nullptr) const;
+    // Return up to count distinct paths from a single search, best first and
+    // starting with an optimal path. Only paths whose score boost
+    // is within score_delta of the optimal score boost are returned.
+    [[nodiscard]] std::vector<Path>
+    best_paths(std::size_t count, int score_delta,
+               GraphSearchStats* stats = nullptr) const;
+    // Return the best path found so far if the terminate flag is set before
+    // the optimal path is found, rather than throwing OptimisationCancelled.
+    // This lets a caller put a time limit on the search by setting the flag
+    // once time is up. The path is the better of a quickly found path and,
+    // with one thread, the best path the branch and bound search reached.
+    [[nodiscard]] AnytimePath
+    anytime_path(GraphSearchStats* stats = nullptr) const;
 };
 
 #endif
@@ -20,81 +20,435 @@
 #define CHOPT_PATH_GRAPH_HPP
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
 #include <optional>
+#include <ranges>
+#include <span>
 #include <stack>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include <boost/container_hash/hash.hpp>
 #include <boost/unordered/unordered_flat_map.hpp>
 #include <boost/unordered/unordered_flat_set.hpp>
 
+#include "workstealing.hpp"
+
+// Hash tables of vertices store VertexKey<Vertex>::make(vertex) rather than the
+// vertex itself. By default the key is just the vertex, but vertex types can
+// specialise VertexKey to use a smaller key that is cheaper to hash and
+// compare. Two vertices must have equal keys exactly when they are equal.
+template <typename Vertex> struct VertexKey {
+    using type = Vertex;
+    using hasher = boost::hash<Vertex>;
+
+    static const Vertex& make(const Vertex& vertex) { return vertex; }
+};
+
+template <typename Vertex, typename Value>
+using VertexMap = boost::unordered_flat_map<typename VertexKey<Vertex>::type,
+                                            Value,
+                                            typename VertexKey<Vertex>::hasher>;
+
+template <typename Vertex, typename Value>
+using PmrVertexMap = boost::unordered_flat_map<
+    typename VertexKey<Vertex>::type, Value, typename VertexKey<Vertex>::hasher,
+    std::equal_to<typename VertexKey<Vertex>::type>,
+    std::pmr::polymorphic_allocator<
+        std::pair<const typename VertexKey<Vertex>::type, Value>>>;
+
+template <typename Vertex>
+using VertexSet = boost::unordered_flat_set<typename VertexKey<Vertex>::type,
+                                            typename VertexKey<Vertex>::hasher>;
+
+// Decides how PathGraph stores edge properties. By default a property is kept
+// in the edge itself. Vectors are instead copied into a pool shared by every
+// edge, and the edge keeps the range of the pool it uses, so an edge does not
+// need its own heap allocation.
+template <typename EdgeProperty> class EdgePropertyStore {
+public:
+    using Handle = EdgeProperty;
+
+    Handle store(EdgeProperty property, bool /*is_staged*/)
+    {
+        return property;
+    }
+
+    Handle restage(const Handle& handle) { return handle; }
+
+    Handle restore(const Handle& handle) { return handle; }
+
+    [[nodiscard]] const EdgeProperty& load(const Handle& handle) const
+    {
+        return handle;
+    }
+
+    [[nodiscard]] std::optional<std::size_t>
+    staged_offset(const Handle& /*handle*/) const
+    {
+        return std::nullopt;
+    }
+
+    void truncate_staged(std::size_t /*offset*/) { }
+};
+
+template <typename T> class EdgePropertyStore<std::vector<T>> {
+public:
+    struct Handle {
+        std::uint32_t offset;
+        std::uint32_t size;
+
+        [[nodiscard]] bool operator==(const Handle& rhs) const = default;
+    };
+
+private:
+    static constexpr std::uint32_t STAGED_FLAG = 1U << 31U;
+
+    std::vector<T> m_pool;
+    std::vector<T> m_staged_pool;
+
+    static Handle append(std::span<const T> elements, std::vector<T>& pool)
+    {
+        const auto offset = static_cast<std::uint32_t>(pool.size());
+        pool.insert(pool.end(), elements.begin(), elements.end());
+        return {.offset = offset,
+                .size = static_cast<std::uint32_t>(elements.size())};
+    }
+
+public:
+    Handle store(std::span<const T> property, bool is_staged)
+    {
+        if (!is_staged) {
+            return append(property, m_pool);
+        }
+        auto handle = append(property, m_staged_pool);
+        handle.offset |= STAGED_FLAG;
+        return handle;
+    }
+
+    // Copies a staged property to the end of the staging pool. The elements
+    // are copied out first as the pool may be reallocated.
+    Handle restage(const Handle& handle)
+    {
+        const auto span = load(handle);
+        const std::vector<T> elements {span.begin(), span.end()};
+        return store(elements, true);
+    }
+
+    // Copies a staged property into the main pool.
+    Handle restore(const Handle& handle)
+    {
+        return append(load(handle), m_pool);
+    }
+
+    [[nodiscard]] std::span<const T> load(const Handle& handle) const
+    {
+        const auto& pool
+            = (handle.offset & STAGED_FLAG) != 0 ? m_staged_pool : m_pool;
+        const auto offset = handle.offset & ~STAGED_FLAG;
+        return std::span<const T> {pool}.subspan(offset, handle.size);
+    }
+
+    [[nodiscard]] std::optional<std::size_t>
+    staged_offset(const Handle& handle) const
+    {
+        if ((handle.offset & STAGED_FLAG) == 0) {
+            return std::nullopt;
+        }
+        return handle.offset & ~STAGED_FLAG;
+    }
+
+    void truncate_staged(std::size_t offset) { m_staged_pool.resize(offset); }
+};
+
 // This data structure is for the directed acyclic graph at the core of the
 // optimiser. Vertices represent a state of how far through the song you are,
 // which can include things like the next note and your current combo. Edges
 // represent activations, with the weight being the number of points gained from
 // using a specific activation. A Star Power path is then a path through this
 // graph, and an optimal path is a path with maximum total weight.
+//
+// Edges are kept in compressed sparse row form: each vertex owns a range of
+// one big edge array. Edges added by add_edge are staged until their source is
+// pruned, at which point the optimal ones are appended to the edge array. The
+// graph is meant to be built depth first, so when a vertex is pruned the staged
+// edges after its own all belong to pruned vertices and can be dropped.
+//
+// A graph made with a positive edge_slack also keeps the edges whose best path
+// is within edge_slack of the optimal one when pruning. These come after the
+// optimal edges, best first, so the first out edge of a vertex is still on an
+// optimal path. Every path within edge_slack of the optimal path is then in
+// the graph.
 template <typename VertexProperty, typename EdgeProperty> class PathGraph {
+private:
+    using PropertyStore = EdgePropertyStore<EdgeProperty>;
+
 public:
     using VertexId = std::size_t;
 
     struct Edge {
         VertexId dest_vertex_id;
         int weight;
-        EdgeProperty property;
+        typename PropertyStore::Handle property;
     };
 
 private:
-    std::vector<std::vector<Edge>> m_adjacency_list;
+    struct EdgeRange {
+        std::size_t begin {0};
+        std::size_t size {0};
+    };
+
+    static constexpr int UNPRUNED_VALUE = std::numeric_limits<int>::min();
+
+    std::vector<Edge> m_edges;
+    std::vector<Edge> m_staged_edges;
+    std::vector<EdgeRange> m_edge_ranges;
     std::vector<VertexProperty> m_vertex_properties;
-    boost::unordered_flat_map<VertexProperty, VertexId>
-        m_reverse_vertex_property_lookup;
-    boost::unordered_flat_map<VertexId, int> m_optimal_subpath_values;
+    VertexMap<VertexProperty, VertexId> m_reverse_vertex_property_lookup;
+    std::vector<int> m_optimal_subpath_values;
+    PropertyStore m_property_store;
+    int m_edge_slack;
+
+    [[nodiscard]] bool is_pruned(VertexId vertex_id) const
+    {
+        return m_optimal_subpath_values.at(vertex_id) != UNPRUNED_VALUE;
+    }
 
 public:
-    explicit PathGraph(VertexProperty root_vertex)
+    explicit PathGraph(VertexProperty root_vertex, int edge_slack = 0)
+        : m_edge_slack {edge_slack}
     {
-        m_adjacency_list.emplace_back();
-        m_vertex_properties.push_back(root_vertex);
-        m_reverse_vertex_property_lookup.emplace(std::move(root_vertex), 0);
+        insert_vertex(std::move(root_vertex));
     }
 
+    static constexpr VertexId REMOVED_VERTEX
+        = std::numeric_limits<VertexId>::max();
+
     std::pair<VertexId, bool> insert_vertex(VertexProperty vertex)
     {
         const auto [iter, inserted] = m_reverse_vertex_property_lookup.emplace(
-            vertex, m_adjacency_list.size());
+            VertexKey<VertexProperty>::make(vertex),
+            m_vertex_properties.size());
         if (inserted) {
-            m_adjacency_list.emplace_back();
-            m_vertex_properties.emplace_back(std::move(vertex));
+            add_untracked_vertex(std::move(vertex));
         }
 
         return {iter->second, inserted};
     }
 
+    // Adds a vertex that find_vertex will not know about, for generators that
+    // keep their own lookup of the vertices they can still reach. The vertex
+    // must not already be in the graph.
+    VertexId add_untracked_vertex(VertexProperty vertex)
+    {
+        m_edge_ranges.emplace_back();
+        m_optimal_subpath_values.push_back(UNPRUNED_VALUE);
+        m_vertex_properties.emplace_back(std::move(vertex));
+        return m_vertex_properties.size() - 1;
+    }
+
+    // The property can be anything the EdgePropertyStore accepts, so vector
+    // properties may use any allocator.
+    template <typename Property = EdgeProperty>
     void add_edge(VertexId source_id, VertexId destination_id, int weight,
-                  EdgeProperty edge_property)
+                  Property&& edge_property)
+    {
+        if (is_pruned(source_id)) {
+            throw std::logic_error("Cannot add edges to a pruned vertex");
+        }
+        auto& range = m_edge_ranges.at(source_id);
+        if (range.begin + range.size != m_staged_edges.size()
+            || range.size == 0) {
+            // The vertex's staged edges are not at the end, so move them there.
+            const auto new_begin = m_staged_edges.size();
+            for (auto i = range.begin; i < range.begin + range.size; ++i) {
+                auto edge = m_staged_edges.at(i);
+                edge.property = m_property_store.restage(edge.property);
+                m_staged_edges.push_back(edge);
+            }
+            range.begin = new_begin;
+        }
+        const auto handle = m_property_store.store(
+            std::forward<Property>(edge_property), true);
+        m_staged_edges.push_back({.dest_vertex_id = destination_id,
+                                  .weight = weight,
+                                  .property = handle});
+        ++range.size;
+    }
+
+    [[nodiscard]] std::span<const Edge> out_edges(VertexId vertex_id) const
     {
-        m_adjacency_list.at(source_id).emplace_back(destination_id, weight,
-                                                    edge_property);
+        const auto& range = m_edge_ranges.at(vertex_id);
+        const auto& edges = is_pruned(vertex_id) ? m_edges : m_staged_edges;
+        return std::span<const Edge> {edges}.subspan(range.begin, range.size);
     }
 
-    [[nodiscard]] const std::vector<Edge>& out_edges(VertexId vertex_id) const
+    [[nodiscard]] decltype(auto) edge_property(const Edge& edge) const
     {
-        return m_adjacency_list.at(vertex_id);
+        return m_property_store.load(edge.property);
     }
 
     [[nodiscard]] VertexId root_vertex_id() const { return 0; }
 
+    [[nodiscard]] int edge_slack() const { return m_edge_slack; }
+
+    [[nodiscard]] std::size_t vertex_count() const
+    {
+        return m_vertex_properties.size();
+    }
+
+    [[nodiscard]] std::optional<VertexId>
+    find_vertex(const VertexProperty& vertex) const
+    {
+        const auto iter = m_reverse_vertex_property_lookup.find(
+            VertexKey<VertexProperty>::make(vertex));
+        if (iter == m_reverse_vertex_property_lookup.end()) {
+            return std::nullopt;
+        }
+        return iter->second;
+    }
+
+    // Returns the value of the best path from a vertex, or nullopt if the
+    // vertex's out edges have not been pruned yet.
+    [[nodiscard]] std::optional<int>
+    optimal_subpath_value(VertexId vertex_id) const
+    {
+        if (!is_pruned(vertex_id)) {
+            return std::nullopt;
+        }
+        return m_optimal_subpath_values.at(vertex_id);
+    }
+
     [[nodiscard]] const VertexProperty&
     vertex_property(VertexId vertex_id) const
     {
         return m_vertex_properties.at(vertex_id);
     }
 
+    // Removes the pruned vertices that no edge leads to, along with every
+    // vertex that only removed vertices lead to. The root, unpruned vertices,
+    // and vertices where is_closed(vertex) is false are always kept, so
+    // is_closed should say whether a vertex can no longer gain in edges. There
+    // must be no staged edges. Returns the new id of each old id, or
+    // REMOVED_VERTEX if the vertex was removed.
+    template <typename F>
+    std::vector<VertexId> discard_unreferenced_vertices(F is_closed)
+    {
+        if (!m_staged_edges.empty()) {
+            throw std::logic_error(
+                "Cannot discard vertices while edges are staged");
+        }
+        const auto count = vertex_count();
+        std::vector<std::size_t> in_degrees(count, 0);
+        for (const auto& edge : m_edges) {
+            ++in_degrees.at(edge.dest_vertex_id);
+        }
+        const auto can_remove = [&](VertexId vertex_id) {
+            return vertex_id != root_vertex_id()
+                && in_degrees.at(vertex_id) == 0 && is_pruned(vertex_id)
+                && is_closed(m_vertex_properties.at(vertex_id));
+        };
+
+        std::vector<VertexId> new_ids(count, 0);
+        std::vector<VertexId> removable_vertices;
+        for (VertexId vertex_id = 0; vertex_id < count; ++vertex_id) {
+            if (can_remove(vertex_id)) {
+                removable_vertices.push_back(vertex_id);
+            }
+        }
+        while (!removable_vertices.empty()) {
+            const auto vertex_id = removable_vertices.back();
+            removable_vertices.pop_back();
+            new_ids.at(vertex_id) = REMOVED_VERTEX;
+            for (const auto& edge : out_edges(vertex_id)) {
+                --in_degrees.at(edge.dest_vertex_id);
+                if (can_remove(edge.dest_vertex_id)) {
+                    removable_vertices.push_back(edge.dest_vertex_id);
+                }
+            }
+        }
+
+        VertexId kept_count = 0;
+        for (auto& new_id : new_ids) {
+            if (new_id != REMOVED_VERTEX) {
+                new_id = kept_count++;
+            }
+        }
+        std::vector<Edge> edges;
+        std::vector<EdgeRange> edge_ranges;
+        std::vector<VertexProperty> vertex_properties;
+        std::vector<int> optimal_subpath_values;
+        PropertyStore property_store;
+        edge_ranges.reserve(kept_count);
+        vertex_properties.reserve(kept_count);
+        optimal_subpath_values.reserve(kept_count);
+        for (VertexId vertex_id = 0; vertex_id < count; ++vertex_id) {
+            if (new_ids.at(vertex_id) == REMOVED_VERTEX) {
+                continue;
+            }
+            if (is_pruned(vertex_id)) {
+                const auto begin = edges.size();
+                for (const auto& edge : out_edges(vertex_id)) {
+                    edges.push_back(
+                        {.dest_vertex_id = new_ids.at(edge.dest_vertex_id),
+                         .weight = edge.weight,
+                         .property = property_store.store(
+                             m_property_store.load(edge.property), false)});
+                }
+                edge_ranges.push_back(
+                    {.begin = begin, .size = edges.size() - begin});
+            } else {
+                edge_ranges.emplace_back();
+            }
+            vertex_properties.push_back(
+                std::move(m_vertex_properties.at(vertex_id)));
+            optimal_subpath_values.push_back(
+                m_optimal_subpath_values.at(vertex_id));
+        }
+
+        boost::unordered::erase_if(m_reverse_vertex_property_lookup,
+                                   [&](const auto& entry) {
+                                       return new_ids.at(entry.second)
+                                           == REMOVED_VERTEX;
+                                   });
+        for (auto& entry : m_reverse_vertex_property_lookup) {
+            entry.second = new_ids.at(entry.second);
+        }
+        m_edges = std::move(edges);
+        m_edge_ranges = std::move(edge_ranges);
+        m_vertex_properties = std::move(vertex_properties);
+        m_optimal_subpath_values = std::move(optimal_subpath_values);
+        m_property_store = std::move(property_store);
+        m_staged_edges.shrink_to_fit();
+        return new_ids;
+    }
+
     void prune_suboptimal_out_edges(VertexId vertex_id)
     {
-        auto& out_edge_set = m_adjacency_list.at(vertex_id);
+        if (is_pruned(vertex_id)) {
+            throw std::logic_error("Vertex has already been pruned");
+        }
+        auto& range = m_edge_ranges.at(vertex_id);
+        const auto staged_begin
+            = std::next(m_staged_edges.begin(),
+                        static_cast<std::ptrdiff_t>(range.begin));
+        const std::ranges::subrange out_edge_set {
+            staged_begin,
+            std::next(staged_begin, static_cast<std::ptrdiff_t>(range.size))};
         const auto subpath_weight = [&](const auto& edge) {
+            if (!is_pruned(edge.dest_vertex_id)) {
+                throw std::out_of_range(
+                    "Destination vertex has not been pruned");
+            }
             return edge.weight
                 + m_optimal_subpath_values.at(edge.dest_vertex_id);
         };
@@ -104,18 +458,48 @@ public:
         if (max_value_edge != std::ranges::end(out_edge_set)) {
             optimal_subpath_value = subpath_weight(*max_value_edge);
         }
-        m_optimal_subpath_values.emplace(vertex_id, optimal_subpath_value);
 
         const auto has_optimal_weight = [&](const auto& edge) {
             return subpath_weight(edge) == optimal_subpath_value;
         };
+        const auto within_slack = [&](const auto& edge) {
+            return subpath_weight(edge) >= optimal_subpath_value - m_edge_slack;
+        };
         const auto suboptimal_range
             = std::ranges::partition(out_edge_set, has_optimal_weight);
-        const auto number_of_optimal_acts
-            = std::distance(std::ranges::begin(out_edge_set),
-                            std::ranges::begin(suboptimal_range));
-        out_edge_set.resize(number_of_optimal_acts);
-        out_edge_set.shrink_to_fit();
+        const auto discarded_range
+            = std::ranges::partition(suboptimal_range, within_slack);
+        std::ranges::stable_sort(std::ranges::begin(suboptimal_range),
+                                 std::ranges::begin(discarded_range),
+                                 std::ranges::greater {}, subpath_weight);
+
+        std::optional<std::size_t> staged_property_offset;
+        const auto new_begin = m_edges.size();
+        for (auto iter = std::ranges::begin(out_edge_set);
+             iter != std::ranges::end(out_edge_set); ++iter) {
+            const auto offset = m_property_store.staged_offset(iter->property);
+            if (offset.has_value()) {
+                staged_property_offset
+                    = std::min(staged_property_offset.value_or(*offset),
+                               *offset);
+            }
+            if (iter < std::ranges::begin(discarded_range)) {
+                m_edges.push_back(
+                    {.dest_vertex_id = iter->dest_vertex_id,
+                     .weight = iter->weight,
+                     .property = m_property_store.restore(iter->property)});
+            }
+        }
+
+        if (range.size > 0
+            && range.begin + range.size == m_staged_edges.size()) {
+            m_staged_edges.resize(range.begin);
+            if (staged_property_offset.has_value()) {
+                m_property_store.truncate_staged(*staged_property_offset);
+            }
+        }
+        range = {.begin = new_begin, .size = m_edges.size() - new_begin};
+        m_optimal_subpath_values.at(vertex_id) = optimal_subpath_value;
     }
 };
 
@@ -127,28 +511,51 @@ public:
 // also allow an empty vector of activations to denote an edge to a dummy
 // vertex, which are used for representing points where we must have maximum SP.
 // Allowing these are a powerful optimisation.
+//
+// Everything the aggregate allocates comes from the memory resource it is
+// constructed with, so an aggregate that is thrown away after its edges are
+// added to the graph can live in an Arena.
 template <typename Vertex, typename Activation> class OutEdgeAggregate {
 public:
     struct Edge {
         Vertex dest_vertex;
         int weight;
-        std::vector<Activation> activations;
+        std::pmr::vector<Activation> activations;
     };
 
 private:
-    std::vector<Edge> m_out_edges;
-    boost::unordered_flat_map<Vertex, std::size_t> m_vertex_indexes;
+    std::pmr::vector<Edge> m_out_edges;
+    PmrVertexMap<Vertex, std::size_t> m_vertex_indexes;
+
+    [[nodiscard]] std::pmr::memory_resource* resource() const
+    {
+        return m_out_edges.get_allocator().resource();
+    }
 
 public:
-    using iterator = std::vector<Edge>::iterator;
+    using iterator = std::pmr::vector<Edge>::iterator;
+
+    OutEdgeAggregate()
+        : OutEdgeAggregate {std::pmr::get_default_resource()}
+    {
+    }
+
+    explicit OutEdgeAggregate(std::pmr::memory_resource* resource)
+        : m_out_edges {resource}
+        , m_vertex_indexes {
+              typename PmrVertexMap<Vertex, std::size_t>::allocator_type {
+                  resource}}
+    {
+    }
 
     void add_activation(Vertex dest_vertex,
                         std::optional<Activation> activation, int weight)
     {
-        const auto [iter, inserted]
-            = m_vertex_indexes.emplace(dest_vertex, m_out_edges.size());
+        const auto [iter, inserted] = m_vertex_indexes.emplace(
+            VertexKey<Vertex>::make(dest_vertex), m_out_edges.size());
         if (inserted) {
-            m_out_edges.push_back({dest_vertex, weight, {}});
+            m_out_edges.push_back({dest_vertex, weight,
+                                   std::pmr::vector<Activation> {resource()}});
             if (activation.has_value()) {
                 m_out_edges.back().activations.push_back(
                     std::move(*activation));
@@ -169,19 +576,93 @@ public:
         }
     }
 
+    // Removes every edge where another edge has at least the same weight and a
+    // destination that dominates, meaning its best subpath is assumed to be at
+    // least as good. Destinations are only comparable if they have the same
+    // key, in which case the one with the smaller position dominates. Returns
+    // the number of edges removed.
+    template <typename KeyFn, typename PositionFn>
+    std::size_t remove_dominated_edges(KeyFn key, PositionFn position)
+    {
+        std::pmr::vector<std::size_t> order(m_out_edges.size(), resource());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::sort(order, {}, [&](auto index) {
+            const auto& vertex = m_out_edges.at(index).dest_vertex;
+            return std::tuple {key(vertex), position(vertex)};
+        });
+
+        std::pmr::vector<bool> is_dominated(m_out_edges.size(), false,
+                                            resource());
+        std::size_t dominated_count = 0;
+        for (auto i = 0U; i < order.size();) {
+            const auto group_key = key(m_out_edges.at(order.at(i)).dest_vertex);
+            auto best_weight = m_out_edges.at(order.at(i)).weight;
+            for (++i; i < order.size()
+                 && key(m_out_edges.at(order.at(i)).dest_vertex) == group_key;
+                 ++i) {
+                const auto weight = m_out_edges.at(order.at(i)).weight;
+                if (weight <= best_weight) {
+                    is_dominated.at(order.at(i)) = true;
+                    ++dominated_count;
+                } else {
+                    best_weight = weight;
+                }
+            }
+        }
+        if (dominated_count == 0) {
+            return 0;
+        }
+
+        std::pmr::vector<Edge> kept_edges {resource()};
+        kept_edges.reserve(m_out_edges.size() - dominated_count);
+        m_vertex_indexes.clear();
+        for (auto i = 0U; i < m_out_edges.size(); ++i) {
+            if (!is_dominated.at(i)) {
+                m_vertex_indexes.emplace(
+                    VertexKey<Vertex>::make(m_out_edges.at(i).dest_vertex),
+                    kept_edges.size());
+                kept_edges.push_back(std::move(m_out_edges.at(i)));
+            }
+        }
+        m_out_edges = std::move(kept_edges);
+        return dominated_count;
+    }
+
     [[nodiscard]] iterator begin() { return m_out_edges.begin(); }
     [[nodiscard]] iterator end() { return m_out_edges.end(); }
 };
 
+// Thrown by the search for an optimal path when it notices its terminate flag
+// has been set.
+class OptimisationCancelled : public std::runtime_error {
+public:
+    OptimisationCancelled()
+        : std::runtime_error {"Optimisation cancelled"}
+    {
+    }
+};
+
+// The graph generators call this before expanding each vertex, so a search can
+// be abandoned promptly by setting terminate from another thread.
+inline void throw_if_cancelled(const std::atomic<bool>* terminate)
+{
+    if (terminate != nullptr && terminate->load(std::memory_order_relaxed)) {
+        throw OptimisationCancelled {};
+    }
+}
+
 template <typename VertexProperty, typename EdgeProperty, typename F>
 inline PathGraph<VertexProperty, EdgeProperty>
-generate_optimal_graph(VertexProperty root_vertex, F out_edges)
+generate_optimal_graph(VertexProperty root_vertex, F out_edges,
+                       const std::atomic<bool>* terminate = nullptr,
+                       int edge_slack = 0)
 {
     std::stack<std::tuple<std::size_t, bool>> unprocessed_vertices {
         {{0, false}}};
-    boost::unordered_flat_set<std::size_t> vertices_with_out_edges;
+    std::vector<bool> vertices_with_out_edges;
 
-    PathGraph<VertexProperty, EdgeProperty> graph {std::move(root_vertex)};
+    PathGraph<VertexProperty, EdgeProperty> graph {std::move(root_vertex),
+                                                   edge_slack};
 
     while (!unprocessed_vertices.empty()) {
         const auto [vertex_id, ready_to_prune] = unprocessed_vertices.top();
@@ -191,12 +672,15 @@ generate_optimal_graph(VertexProperty root_vertex, F out_edges)
             continue;
         }
 
-        if (vertices_with_out_edges.contains(vertex_id)) {
+        if (vertex_id < vertices_with_out_edges.size()
+            && vertices_with_out_edges[vertex_id]) {
             continue;
         }
-        vertices_with_out_edges.emplace(vertex_id);
+        throw_if_cancelled(terminate);
+        vertices_with_out_edges.resize(graph.vertex_count(), false);
+        vertices_with_out_edges[vertex_id] = true;
         unprocessed_vertices.emplace(vertex_id, true);
-        auto edges = out_edges(graph, vertex_id);
+        auto edges = out_edges(graph.vertex_property(vertex_id));
 
         for (auto& edge : edges) {
             const auto [dest_vertex_id, inserted]
@@ -210,4 +694,535 @@ generate_optimal_graph(VertexProperty root_vertex, F out_edges)
     return graph;
 }
 
+// Builds a graph with the same optimal path as generate_optimal_graph one
+// point at a time rather than depth first. point_index must give every out
+// edge's destination a larger index than the edge's source.
+//
+// Vertices are first found by expanding them in increasing point order, and
+// then pruned from the last point back to the first. Only earlier points can
+// add vertices to a point's bucket, so the bucket is complete once the
+// forward sweep reaches it, and the table used to deduplicate its vertices is
+// freed after it is expanded. Out edges are not kept between the sweeps: each
+// vertex is expanded again when it is pruned, and its edges are freed once it
+// has been pruned. A bucket's vertices are freed once it has been pruned, and
+// the table looking up the ids of its vertices is freed once the earliest
+// point with an edge to the bucket has been pruned. Both sweeps go through
+// the buckets in order, so work stays in a few neighbouring points rather
+// than jumping around the whole graph.
+//
+// If discard_unreachable is set, then whenever the graph has doubled in size,
+// pruned vertices that no edge can lead to any more are discarded, and the
+// returned graph only holds vertices reachable from the root. find_vertex
+// then only knows about the root. Otherwise every vertex is kept and can be
+// found with find_vertex, and the kept edges of each vertex are the same as
+// generate_optimal_graph keeps, in the same order.
+template <typename VertexProperty, typename EdgeProperty, typename F,
+          typename G>
+inline PathGraph<VertexProperty, EdgeProperty>
+generate_optimal_graph_by_points(VertexProperty root_vertex, F out_edges,
+                                 G point_index, bool discard_unreachable,
+                                 const std::atomic<bool>* terminate,
+                                 int edge_slack)
+{
+    using Graph = PathGraph<VertexProperty, EdgeProperty>;
+
+    struct Bucket {
+        std::vector<VertexProperty> vertices;
+        VertexSet<VertexProperty> found_vertices;
+        VertexMap<VertexProperty, typename Graph::VertexId> vertex_ids;
+        // Buckets whose vertex ids are no longer needed once this bucket has
+        // been pruned.
+        std::vector<std::size_t> last_needed_by;
+        std::optional<std::size_t> first_source;
+        bool is_closed {false};
+    };
+
+    Graph graph {root_vertex, edge_slack};
+    std::vector<Bucket> buckets;
+
+    const auto first_bucket = point_index(root_vertex);
+    buckets.resize(first_bucket + 1);
+    buckets.at(first_bucket).vertices.push_back(std::move(root_vertex));
+    for (auto i = first_bucket; i < buckets.size(); ++i) {
+        for (auto j = 0U; j < buckets.at(i).vertices.size(); ++j) {
+            throw_if_cancelled(terminate);
+            auto edges = out_edges(buckets.at(i).vertices.at(j));
+            for (const auto& edge : edges) {
+                const auto dest_index = point_index(edge.dest_vertex);
+                if (dest_index <= i) {
+                    throw std::logic_error(
+                        "Out edges must go to a later point");
+                }
+                if (dest_index >= buckets.size()) {
+                    buckets.resize(dest_index + 1);
+                }
+                auto& dest_bucket = buckets.at(dest_index);
+                if (dest_bucket.found_vertices
+                        .insert(VertexKey<VertexProperty>::make(
+                            edge.dest_vertex))
+                        .second) {
+                    dest_bucket.vertices.push_back(edge.dest_vertex);
+                }
+                if (!dest_bucket.first_source.has_value()) {
+                    dest_bucket.first_source = i;
+                    buckets.at(i).last_needed_by.push_back(dest_index);
+                }
+            }
+        }
+        auto& found_vertices = buckets.at(i).found_vertices;
+        found_vertices = decltype(Bucket::found_vertices) {};
+    }
+
+    auto compacted_size = graph.vertex_count();
+    for (auto i = buckets.size(); i-- > first_bucket;) {
+        auto& bucket = buckets.at(i);
+        bucket.vertex_ids.reserve(bucket.vertices.size());
+        for (auto j = 0U; j < bucket.vertices.size(); ++j) {
+            throw_if_cancelled(terminate);
+            const auto& vertex = bucket.vertices.at(j);
+            auto edges = out_edges(vertex);
+            const auto vertex_id = [&] {
+                if (i == first_bucket && j == 0) {
+                    return graph.root_vertex_id();
+                }
+                if (discard_unreachable) {
+                    return graph.add_untracked_vertex(vertex);
+                }
+                return graph.insert_vertex(vertex).first;
+            }();
+            for (auto& edge : edges) {
+                const auto& dest_ids
+                    = buckets.at(point_index(edge.dest_vertex)).vertex_ids;
+                graph.add_edge(vertex_id,
+                               dest_ids.at(VertexKey<VertexProperty>::make(
+                                   edge.dest_vertex)),
+                               edge.weight, std::move(edge.activations));
+            }
+            graph.prune_suboptimal_out_edges(vertex_id);
+            bucket.vertex_ids.emplace(VertexKey<VertexProperty>::make(vertex),
+                                      vertex_id);
+        }
+        bucket.vertices = decltype(Bucket::vertices) {};
+        for (const auto unneeded_bucket : bucket.last_needed_by) {
+            auto& closed_bucket = buckets.at(unneeded_bucket);
+            closed_bucket.vertex_ids = decltype(Bucket::vertex_ids) {};
+            closed_bucket.is_closed = true;
+        }
+        if (discard_unreachable
+            && graph.vertex_count() >= 2 * compacted_size) {
+            const auto new_ids
+                = graph.discard_unreferenced_vertices([&](const auto& vertex) {
+                      return buckets.at(point_index(vertex)).is_closed;
+                  });
+            for (auto k = i; k < buckets.size(); ++k) {
+                for (auto& entry : buckets.at(k).vertex_ids) {
+                    entry.second = new_ids.at(entry.second);
+                }
+            }
+            compacted_size = graph.vertex_count();
+        }
+    }
+
+    if (discard_unreachable) {
+        graph.discard_unreferenced_vertices([](const auto& /*vertex*/) {
+            return true;
+        });
+    }
+    return graph;
+}
+
+// Produces a graph with the same optimal path as generate_optimal_graph, and
+// the same kept edges for each vertex in the same order, by building it one
+// point at a time from the end of the song with
+// generate_optimal_graph_by_points. Vertex ids differ from
+// generate_optimal_graph.
+template <typename VertexProperty, typename EdgeProperty, typename F,
+          typename G>
+inline PathGraph<VertexProperty, EdgeProperty>
+generate_optimal_graph_bottom_up(VertexProperty root_vertex, F out_edges,
+                                 G point_index,
+                                 const std::atomic<bool>* terminate = nullptr,
+                                 int edge_slack = 0)
+{
+    return generate_optimal_graph_by_points<VertexProperty, EdgeProperty, F,
+                                            G>(std::move(root_vertex),
+                                               std::move(out_edges),
+                                               std::move(point_index), false,
+                                               terminate, edge_slack);
+}
+
+// Produces a graph with the same optimal path as generate_optimal_graph while
+// only keeping what can still be on a path from the root, building it with
+// generate_optimal_graph_by_points and discarding unreachable vertices as it
+// goes. find_vertex only knows about the root.
+template <typename VertexProperty, typename EdgeProperty, typename F,
+          typename G>
+inline PathGraph<VertexProperty, EdgeProperty>
+generate_optimal_graph_low_memory(VertexProperty root_vertex, F out_edges,
+                                  G point_index,
+                                  const std::atomic<bool>* terminate = nullptr,
+                                  int edge_slack = 0)
+{
+    return generate_optimal_graph_by_points<VertexProperty, EdgeProperty, F,
+                                            G>(std::move(root_vertex),
+                                               std::move(out_edges),
+                                               std::move(point_index), true,
+                                               terminate, edge_slack);
+}
+
+// Counts of the work done while generating a graph.
+struct GraphSearchStats {
+    std::size_t expanded_vertices {0};
+    std::size_t pruned_vertices {0};
+    std::size_t dominated_edges {0};
+    // Allocations served by arenas, and the blocks the arenas took from the
+    // heap to serve them.
+    std::size_t arena_allocations {0};
+    std::size_t arena_blocks {0};
+    std::size_t candidate_cache_hits {0};
+    std::size_t candidate_cache_misses {0};
+    // The vertices in the finished graph, and the out edges found each time a
+    // vertex was expanded.
+    std::size_t graph_vertices {0};
+    std::size_t generated_edges {0};
+    // Edges to vertices standing for a point where the SP bar must be full.
+    std::size_t max_sp_edges {0};
+    // Activation validity checks by their result, not counting those answered
+    // by the candidate cache.
+    std::size_t successful_candidates {0};
+    std::size_t insufficient_sp_candidates {0};
+    std::size_t surplus_sp_candidates {0};
+    // Activation ends passed over without a check because an earlier
+    // activation start already reached them.
+    std::size_t skipped_act_ends {0};
+    std::chrono::duration<double> graph_time {0.0};
+    std::chrono::duration<double> path_time {0.0};
+    // The most points the best path in the graph can be below the optimal
+    // path. Only non-zero when generate_optimal_graph_bounded is given a
+    // positive tolerance.
+    int max_score_loss {0};
+};
+
+// Produces a graph with the same optimal path as generate_optimal_graph, but
+// avoids expanding vertices that cannot be on an optimal path. upper_bound must
+// return a value at least as large as the best path from a vertex. The out
+// edges of each vertex are explored best-first by their weight plus the bound
+// of their destination, and once an edge cannot beat the best subpath already
+// found from its source, it and all the edges after it are skipped.
+//
+// Skipped edges are all strictly suboptimal, so the kept edges of each vertex
+// are the same as generate_optimal_graph would keep, and in the same order.
+// With a positive edge_slack, edges are only skipped once they cannot come
+// within edge_slack of the best subpath, so this still holds.
+//
+// With a positive tolerance, edges to vertices not yet in the graph are also
+// skipped when they can beat the best subpath by at most tolerance, and the
+// best path is no longer always optimal. By induction on the vertices, the
+// best subpath of each expanded vertex is at most the largest such margin
+// below optimal: if its optimal edge was followed, the destination's error
+// carries over unchanged, and if not, the edge was skipped against a value
+// the vertex's best subpath is at least as large as. Edges to vertices
+// already in the graph are only skipped as in the exact search, since their
+// values may themselves be below optimal. The largest margin is stored in
+// stats.max_score_loss, and is never more than tolerance.
+//
+// If is_complete is null, OptimisationCancelled is thrown once terminate is
+// set. Otherwise the search stops instead and *is_complete is set to false:
+// the vertex being expanded becomes the end of its paths, the edges not yet
+// explored are skipped, and the root's best path is the best path found so
+// far. *is_complete is set to true if the search finishes.
+template <typename VertexProperty, typename EdgeProperty, typename F,
+          typename G>
+inline PathGraph<VertexProperty, EdgeProperty>
+generate_optimal_graph_bounded(VertexProperty root_vertex, F out_edges,
+                               G upper_bound, GraphSearchStats& stats,
+                               const std::atomic<bool>* terminate = nullptr,
+                               int edge_slack = 0, int tolerance = 0,
+                               bool* is_complete = nullptr)
+{
+    if (edge_slack > 0 && tolerance > 0) {
+        throw std::invalid_argument(
+            "Edge slack and tolerance cannot both be positive");
+    }
+
+    using OutEdges = decltype(out_edges(root_vertex));
+
+    struct SearchFrame {
+        std::size_t vertex_id;
+        OutEdges edges;
+        std::vector<std::tuple<int, std::size_t>> edge_order;
+        std::size_t next_edge {0};
+        std::vector<std::optional<std::size_t>> dest_vertex_ids;
+        int best_value {0};
+    };
+
+    PathGraph<VertexProperty, EdgeProperty> graph {root_vertex, edge_slack};
+    VertexSet<VertexProperty> skipped_vertices;
+    std::vector<SearchFrame> frames;
+    auto is_stopped = false;
+
+    const auto find_out_edges
+        = [&](std::size_t vertex_id) -> std::optional<OutEdges> {
+        try {
+            throw_if_cancelled(terminate);
+            return out_edges(graph.vertex_property(vertex_id));
+        } catch (const OptimisationCancelled&) {
+            if (is_complete == nullptr) {
+                throw;
+            }
+            is_stopped = true;
+            return std::nullopt;
+        }
+    };
+
+    // Returns false if the search stopped before the vertex's out edges were
+    // found, leaving the vertex pruned with no out edges.
+    const auto expand_vertex = [&](std::size_t vertex_id) {
+        ++stats.expanded_vertices;
+        auto found_edges = find_out_edges(vertex_id);
+        if (!found_edges.has_value()) {
+            graph.prune_suboptimal_out_edges(vertex_id);
+            return false;
+        }
+        auto& edges = *found_edges;
+        std::vector<std::tuple<int, std::size_t>> edge_order;
+        for (auto& edge : edges) {
+            auto bound = 0;
+            const auto dest_id = graph.find_vertex(edge.dest_vertex);
+            if (dest_id.has_value()) {
+                bound = *graph.optimal_subpath_value(*dest_id);
+            } else {
+                bound = upper_bound(edge.dest_vertex);
+            }
+            edge_order.emplace_back(edge.weight + bound, edge_order.size());
+        }
+        std::ranges::stable_sort(edge_order, std::ranges::greater {},
+                                 [](const auto& t) { return std::get<0>(t); });
+        const auto edge_count = edge_order.size();
+        frames.push_back({.vertex_id = vertex_id,
+                          .edges = std::move(edges),
+                          .edge_order = std::move(edge_order),
+                          .next_edge = 0,
+                          .dest_vertex_ids
+                          = std::vector<std::optional<std::size_t>>(edge_count),
+                          .best_value = 0});
+        return true;
+    };
+
+    expand_vertex(graph.root_vertex_id());
+
+    while (!frames.empty()) {
+        auto& frame = frames.back();
+        auto edges = frame.edges.begin();
+        if (is_stopped) {
+            frame.next_edge = frame.edge_order.size();
+        }
+        if (frame.next_edge < frame.edge_order.size()) {
+            const auto [optimistic_value, index]
+                = frame.edge_order.at(frame.next_edge);
+            ++frame.next_edge;
+            const auto& edge = *std::next(edges, index);
+            const auto is_new_vertex
+                = !graph.find_vertex(edge.dest_vertex).has_value();
+            const auto is_within_tolerance = tolerance > 0 && is_new_vertex
+                && optimistic_value <= frame.best_value + tolerance;
+            if (optimistic_value < frame.best_value - edge_slack
+                || is_within_tolerance) {
+                if (is_new_vertex) {
+                    skipped_vertices.insert(
+                        VertexKey<VertexProperty>::make(edge.dest_vertex));
+                }
+                stats.max_score_loss
+                    = std::max(stats.max_score_loss,
+                               optimistic_value - frame.best_value);
+                continue;
+            }
+            const auto [dest_id, inserted]
+                = graph.insert_vertex(edge.dest_vertex);
+            frame.dest_vertex_ids.at(index) = dest_id;
+            if (!inserted) {
+                frame.best_value
+                    = std::max(frame.best_value,
+                               edge.weight
+                                   + *graph.optimal_subpath_value(dest_id));
+                continue;
+            }
+            skipped_vertices.erase(
+                VertexKey<VertexProperty>::make(edge.dest_vertex));
+            if (!expand_vertex(dest_id)) {
+                frame.best_value = std::max(frame.best_value, edge.weight);
+            }
+            continue;
+        }
+
+        // This partitions the edges exactly as prune_suboptimal_out_edges
+        // would have done with every edge present, so the first optimal edge
+        // is the same as in the full graph.
+        std::vector<std::size_t> edge_indexes(frame.dest_vertex_ids.size());
+        std::iota(edge_indexes.begin(), edge_indexes.end(), 0);
+        const auto subpath_value = [&](std::size_t index) {
+            const auto& dest_id = frame.dest_vertex_ids.at(index);
+            if (!dest_id.has_value()) {
+                return std::numeric_limits<int>::min();
+            }
+            return std::next(edges, index)->weight
+                + *graph.optimal_subpath_value(*dest_id);
+        };
+        const auto is_optimal = [&](std::size_t index) {
+            return subpath_value(index) == frame.best_value;
+        };
+        const auto within_slack = [&](std::size_t index) {
+            return subpath_value(index) >= frame.best_value - edge_slack;
+        };
+        const auto suboptimal_range
+            = std::ranges::partition(edge_indexes, is_optimal);
+        const auto discarded_range
+            = std::ranges::partition(suboptimal_range, within_slack);
+        edge_indexes.erase(std::ranges::begin(discarded_range),
+                           edge_indexes.end());
+        for (auto index : edge_indexes) {
+            auto& edge = *std::next(edges, index);
+            graph.add_edge(frame.vertex_id, *frame.dest_vertex_ids.at(index),
+                           edge.weight, std::move(edge.activations));
+        }
+        graph.prune_suboptimal_out_edges(frame.vertex_id);
+
+        const auto value = frame.best_value;
+        frames.pop_back();
+        if (!frames.empty()) {
+            auto& parent = frames.back();
+            const auto parent_index
+                = std::get<1>(parent.edge_order.at(parent.next_edge - 1));
+            parent.best_value = std::max(
+                parent.best_value,
+                std::next(parent.edges.begin(), parent_index)->weight + value);
+        }
+    }
+
+    stats.pruned_vertices += skipped_vertices.size();
+    if (is_complete != nullptr) {
+        *is_complete = !is_stopped;
+    }
+    return graph;
+}
+
+// A hash table from vertices to values that can be used from multiple threads
+// at once. The table is split into shards with their own locks, so threads
+// only contend when they touch vertices that hash to the same shard.
+template <typename Vertex, typename Value> class ConcurrentVertexTable {
+private:
+    static constexpr int SHARD_BITS = 6;
+    static constexpr std::size_t SHARD_COUNT = std::size_t {1} << SHARD_BITS;
+    static constexpr std::size_t SHARD_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+    using Key = VertexKey<Vertex>;
+
+    struct Shard {
+        std::mutex mutex;
+        VertexMap<Vertex, std::optional<Value>> values;
+    };
+
+    std::array<Shard, SHARD_COUNT> m_shards;
+
+    // The shard is chosen from the top bits of a remixed hash, so the vertices
+    // in a shard do not all share the bits the hash table itself relies on.
+    Shard& shard(const typename Key::type& key)
+    {
+        const auto hash = typename Key::hasher {}(key) * SHARD_MULTIPLIER;
+        return m_shards.at(hash >> (sizeof(std::size_t) * 8 - SHARD_BITS));
+    }
+
+public:
+    // Returns true if this is the first claim on the vertex, in which case the
+    // caller is responsible for storing its value.
+    bool try_claim(const Vertex& vertex)
+    {
+        const auto& key = Key::make(vertex);
+        auto& vertex_shard = shard(key);
+        const std::scoped_lock lock {vertex_shard.mutex};
+        return vertex_shard.values.try_emplace(key).second;
+    }
+
+    void store(const Vertex& vertex, Value value)
+    {
+        const auto& key = Key::make(vertex);
+        auto& vertex_shard = shard(key);
+        const std::scoped_lock lock {vertex_shard.mutex};
+        vertex_shard.values.at(key) = std::move(value);
+    }
+
+    // Removes and returns the vertex's value. Throws std::logic_error if the
+    // vertex was never claimed, or was claimed without a value being stored.
+    Value take(const Vertex& vertex)
+    {
+        const auto& key = Key::make(vertex);
+        auto& vertex_shard = shard(key);
+        const std::scoped_lock lock {vertex_shard.mutex};
+        const auto iter = vertex_shard.values.find(key);
+        if (iter == vertex_shard.values.end() || !iter->second.has_value()) {
+            throw std::logic_error("Vertex has no stored value to take");
+        }
+        auto result = std::move(*iter->second);
+        vertex_shard.values.erase(iter);
+        return result;
+    }
+};
+
+// Produces the same graph as generate_optimal_graph, but calls out_edges on
+// thread_count threads. Every reachable vertex is first expanded on a
+// work-stealing pool, with the results kept in a ConcurrentVertexTable. The
+// graph is then assembled by the serial algorithm from the stored results, so
+// vertex ids and edge order are exactly as they would be for a serial build.
+// Only the expansion is parallel: every vertex's out edges are held in memory
+// at once until the graph is assembled, which is done on the calling thread
+// and frees each vertex's edges as it takes them.
+//
+// seed_vertices are extra vertices to start expanding from straight away,
+// which lets each thread begin work in a different part of the song instead
+// of waiting for the search from the root to get there. They are not solved
+// separately: their expansions go in the same table as the root's, so a
+// search reaching a seed just finds it already claimed, and the one graph is
+// assembled from the root. They should be reachable from the root; if not,
+// their expansion is just wasted work.
+template <typename VertexProperty, typename EdgeProperty, typename F>
+inline PathGraph<VertexProperty, EdgeProperty>
+generate_optimal_graph_parallel(
+    VertexProperty root_vertex, F out_edges, unsigned int thread_count,
+    const std::vector<VertexProperty>& seed_vertices = {},
+    const std::atomic<bool>* terminate = nullptr, int edge_slack = 0)
+{
+    using OutEdges = decltype(out_edges(root_vertex));
+
+    ConcurrentVertexTable<VertexProperty, OutEdges> expansions;
+    std::vector<VertexProperty> initial_vertices;
+    initial_vertices.reserve(seed_vertices.size() + 1);
+    for (const auto& vertex : seed_vertices) {
+        if (expansions.try_claim(vertex)) {
+            initial_vertices.push_back(vertex);
+        }
+    }
+    if (expansions.try_claim(root_vertex)) {
+        initial_vertices.push_back(root_vertex);
+    }
+
+    work_stealing_for_each<VertexProperty>(
+        std::move(initial_vertices), thread_count,
+        [&](VertexProperty vertex, auto& spawn) {
+            throw_if_cancelled(terminate);
+            auto edges = out_edges(vertex);
+            for (auto& edge : edges) {
+                if (expansions.try_claim(edge.dest_vertex)) {
+                    spawn(edge.dest_vertex);
+                }
+            }
+            expansions.store(vertex, std::move(edges));
+        });
+
+    const auto stored_out_edges
+        = [&](const VertexProperty& vertex) { return expansions.take(vertex); };
+    return generate_optimal_graph<VertexProperty, EdgeProperty,
+                                  decltype(stored_out_edges)>(
+        std::move(root_vertex), stored_out_edges, terminate, edge_slack);
+}
+
 #endif
@@ -49,12 +49,25 @@ struct Point {
 
 using PointPtr = const Point*;
 
+// The timing of a note before squeeze and video lag are applied, kept so a
+// PointSet can apply new values of those without going back to the tempo map
+// for everything else.
+struct NoteTiming {
+    SpPosition position;
+    SightRead::Second time;
+    SightRead::Second early_window;
+    SightRead::Second late_window;
+};
+
 class PointSet {
 private:
+    std::vector<NoteTiming> m_note_timings;
     std::vector<Point> m_points;
     std::vector<PointPtr> m_first_after_current_sp;
     std::vector<PointPtr> m_next_non_hold_point;
     std::vector<PointPtr> m_next_sp_granting_note;
+    std::vector<PointPtr> m_next_fill_point;
+    std::vector<SpMeasure> m_latest_window_ends;
     std::vector<std::tuple<SpPosition, int>> m_solo_boosts;
     std::vector<int> m_cumulative_score_totals;
     SightRead::Second m_video_lag;
@@ -64,6 +77,19 @@ public:
     PointSet(const SightRead::NoteTrack& track,
              const SpDurationData& duration_data,
              const PathingSettings& pathing_settings);
+    // A copy's lookup tables point into its own points.
+    PointSet(const PointSet& other);
+    PointSet(PointSet&& other) = default;
+    PointSet& operator=(const PointSet& other) = delete;
+    PointSet& operator=(PointSet&& other) = default;
+    ~PointSet() = default;
+    // Recomputes the timing windows and positions of the points for a new
+    // squeeze and video lag, keeping everything else. The points keep their
+    // addresses. The track, duration data, engine and drum settings must be
+    // those the PointSet was made with.
+    void apply_timing_settings(const SightRead::NoteTrack& track,
+                               const SpDurationData& duration_data,
+                               const PathingSettings& pathing_settings);
     [[nodiscard]] PointPtr cbegin() const { return m_points.data(); }
     [[nodiscard]] PointPtr cend() const
     {
@@ -76,6 +102,17 @@ public:
     [[nodiscard]] PointPtr first_after_current_phrase(PointPtr point) const;
     [[nodiscard]] PointPtr next_non_hold_point(PointPtr point) const;
     [[nodiscard]] PointPtr next_sp_granting_note(PointPtr point) const;
+    // Returns the first point at or after the given point that ends a drum
+    // fill, or cend() if there is none.
+    [[nodiscard]] PointPtr next_fill_point(PointPtr point) const;
+    // Returns the first point at or after start whose hit window ends after
+    // measure, or cend() if there is none. Sustain points' windows end at
+    // their own position, so window ends are not in point order; this
+    // gallops over a running maximum of them instead, taking time
+    // logarithmic in the distance to the result. If a point before start
+    // has a window ending after measure, it falls back to a linear scan.
+    [[nodiscard]] PointPtr first_window_end_after(PointPtr start,
+                                                  SpMeasure measure) const;
     [[nodiscard]] std::string colour_set(PointPtr point) const
     {
         return m_colours[static_cast<std::size_t>(
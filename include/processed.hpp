@@ -19,6 +19,7 @@
 #ifndef CHOPT_PROCESSED_HPP
 #define CHOPT_PROCESSED_HPP
 
+#include <cstddef>
 #include <limits>
 #include <string>
 #include <tuple>
@@ -72,6 +73,31 @@ struct Path {
     int score_boost {0};
 };
 
+// Measures of a song that are quick to find and that the optimiser's running
+// time grows with. These are used to guess which songs of a batch will take
+// longest, so they can be started first.
+struct RuntimeFeatures {
+    std::size_t point_count;
+    std::size_t phrase_count;
+    // The fraction of the song from the first point to the last that can be
+    // whammied.
+    double whammy_coverage;
+    // The fraction of points that are sustain points.
+    double sustain_density;
+
+    // A guess at the running time relative to other songs, in no particular
+    // unit. The optimiser expands a vertex for each way of reaching a point
+    // with some SP, and each expansion looks through the points after it, so
+    // the guess grows with the product of the point and phrase counts.
+    // Sustains and whammy add more SP levels and activation ends to consider.
+    [[nodiscard]] double predicted_cost() const
+    {
+        return static_cast<double>(point_count)
+            * static_cast<double>(phrase_count + 1) * (1.0 + sustain_density)
+            * (1.0 + whammy_coverage);
+    }
+};
+
 // Represents a song processed for Star Power optimisation. The constructor
 // should only fail due to OOM; invariants on the song are supposed to be
 // upheld by the constructors of the arguments.
@@ -97,11 +123,15 @@ private:
     bool m_is_drums;
     bool m_overlaps;
 
+    void set_phrase_note_spans(const SightRead::NoteTrack& track);
     [[nodiscard]] SpBar sp_from_phrases(PointPtr begin, PointPtr end) const;
     [[nodiscard]] std::vector<std::string>
     act_summaries(const Path& path) const;
     [[nodiscard]] std::vector<std::string>
     drum_act_summaries(const Path& path) const;
+    void append_score_summary(
+        std::stringstream& stream, const Path& path,
+        const std::vector<std::string>& activation_summaries) const;
     void append_activation(std::stringstream& stream,
                            const Activation& activation,
                            const std::string& act_summary) const;
@@ -126,6 +156,21 @@ public:
     ProcessedSong(const SightRead::NoteTrack& track,
                   const SpDurationData& duration_data,
                   const PathingSettings& pathing_settings);
+    // A copy's PointPtrs point into its own points, so a copy can be given
+    // other timing settings without recomputing the rest of the song.
+    ProcessedSong(const ProcessedSong& other);
+    ProcessedSong(ProcessedSong&& other) = default;
+    ProcessedSong& operator=(const ProcessedSong& other) = delete;
+    ProcessedSong& operator=(ProcessedSong&& other) = default;
+    ~ProcessedSong() = default;
+    // Updates the song for new squeeze, early whammy, lazy whammy and video
+    // lag settings. Only the timing windows, whammy ranges and what depends on
+    // them are recomputed; everything else, such as the points themselves and
+    // their scores, is kept. PointPtrs into the song stay valid. The other
+    // arguments and settings must be the same as the song was made with.
+    void apply_timing_settings(const SightRead::NoteTrack& track,
+                               const SpDurationData& duration_data,
+                               const PathingSettings& pathing_settings);
 
     // Return the minimum and maximum amount of SP can be acquired between two
     // points. Does not include SP from the point act_start. first_point is
@@ -153,6 +198,11 @@ public:
         SpPosition required_whammy_end = default_position()) const;
     // Return the summary of a path.
     [[nodiscard]] std::string path_summary(const Path& path) const;
+    [[nodiscard]] RuntimeFeatures runtime_features() const;
+    // Return the path summary without the details of each activation, which
+    // only needs the points each activation starts and ends on and the score
+    // boost.
+    [[nodiscard]] std::string score_summary(const Path& path) const;
 
     // Return the position that is (100 - squeeze)% along the start of point's
     // timing window.
@@ -19,9 +19,13 @@
 #ifndef CHOPT_SETTINGS_HPP
 #define CHOPT_SETTINGS_HPP
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include <QStringList>
 #include <QTextStream>
@@ -57,12 +61,77 @@ struct PathingSettings {
     SightRead::DrumSettings drum_settings;
 };
 
+// Options that change how the optimiser searches for a path, as opposed to
+// PathingSettings which change what the optimal path is.
+struct OptimiserSettings {
+    unsigned int thread_count {1};
+    // Skip vertices that cannot beat the best path found so far. Only used
+    // when thread_count is 1.
+    bool branch_and_bound {false};
+    // Build the graph one point at a time, expanding each vertex a second
+    // time instead of keeping its out edges, and discard parts of the graph
+    // that cannot be on a path from the root. Only used when thread_count is
+    // 1 and branch_and_bound is off.
+    bool low_memory {false};
+    // Build the graph one point at a time from the end of the song like
+    // low_memory, but keep every vertex rather than discarding them. Only
+    // used when thread_count is 1 and branch_and_bound and low_memory are
+    // off.
+    bool bottom_up {false};
+    // If positive, skip parts of the search that could beat the best path
+    // found so far by at most this many points, so the path found may be up
+    // to this many points below optimal. Only used when thread_count is 1,
+    // and implies branch_and_bound.
+    int approximation_tolerance {0};
+    // Skip out edges to a vertex when another out edge has at least the same
+    // weight and goes to the same point with an earlier position.
+    bool merge_dominated_vertices {false};
+    // Run the search with and without merge_dominated_vertices, returning the
+    // unmerged path and throwing if the score boosts differ.
+    bool verify_dominated_vertices {false};
+    // Roughly how much memory the cache of activation validity results may
+    // use, going by CandidateCache::ENTRY_BYTES per result. 0 disables the
+    // cache. The cache only helps when the same candidate comes up from many
+    // vertices, which is rare enough on most charts that it is off by default.
+    std::size_t candidate_cache_bytes {0};
+    // Report the most memory the process has used.
+    bool report_peak_memory {false};
+    // Report the counts and timings in GraphSearchStats as a line of JSON.
+    bool report_stats {false};
+    // Report how far the search has got in steps of 10%.
+    bool report_progress {false};
+    // If set, the optimiser is stopped after this long and returns the best
+    // path found so far.
+    std::optional<std::chrono::milliseconds> time_limit {};
+    // The number of paths to list after the optimal one, each the best path
+    // not yet listed. Only paths within alternative_score_delta of the optimal
+    // score boost are listed.
+    std::size_t alternative_paths {0};
+    int alternative_score_delta {0};
+
+    [[nodiscard]] bool operator==(const OptimiserSettings& rhs) const
+        = default;
+};
+
+// A squeeze level to find a path for when sweeping over several at once.
+struct SqueezeLevel {
+    int percent;
+    double squeeze;
+    double early_whammy;
+};
+
 // This struct represents the options chosen on the command line by the user.
 struct Settings {
     bool blank;
     std::string filename;
+    // If not empty, every chart in this folder and its subfolders is pathed
+    // instead of filename, setlist_jobs at a time. Each image is saved next to
+    // its chart with the file name of image_path.
+    std::string setlist_path {};
+    unsigned int setlist_jobs {1};
     std::string image_path;
     bool draw_image;
+    bool score_only;
     bool draw_bpms;
     bool draw_solos;
     bool draw_time_sigs;
@@ -72,6 +141,10 @@ struct Settings {
     bool is_lefty_flip;
     Game game;
     PathingSettings pathing_settings;
+    OptimiserSettings optimiser_settings;
+    // If not empty, a path is found for each of these levels instead of the
+    // squeeze and early whammy in pathing_settings.
+    std::vector<SqueezeLevel> squeeze_sweep {};
     float opacity;
 };
 
@@ -82,6 +82,16 @@ struct SpSustain {
     bool releasable_for_burst;
 };
 
+// The parts of an SpSustain that do not depend on early whammy, lazy whammy
+// or video lag.
+struct SpSustainTiming {
+    SightRead::Tick note_position;
+    SightRead::Second note_time;
+    SightRead::Second early_timing_window;
+    SpPosition whammy_end;
+    bool releasable_for_burst;
+};
+
 // This is used by the optimiser to calculate SP drain.
 class SpData {
 private:
@@ -102,6 +112,7 @@ private:
     SpTimeMap m_time_map;
     SpGainMode m_gain_mode;
     std::vector<BeatRate> m_beat_rates;
+    std::vector<SpSustainTiming> m_sustain_timings;
     std::vector<SpSustain> m_sp_sustains;
     SightRead::Beat m_last_whammy_point {
         -std::numeric_limits<double>::infinity()};
@@ -113,6 +124,8 @@ private:
     form_beat_rates(const SightRead::TempoMap& tempo_map,
                     const std::vector<SightRead::Tick>& od_beats,
                     const Engine& engine);
+    void set_sp_sustains(const SightRead::TempoMap& tempo_map,
+                         const PathingSettings& pathing_settings);
 
     [[nodiscard]] double
     propagate_over_whammy_range(SightRead::Beat start, SightRead::Beat end,
@@ -129,6 +142,8 @@ private:
                                                 double sp_bar_amount) const;
     [[nodiscard]] double sp_from_whammying_range(SightRead::Beat start,
                                                  SightRead::Beat end) const;
+    [[nodiscard]] SightRead::Beat whammy_gain_end(SightRead::Beat start,
+                                                  double sp) const;
     double add_reserved_burst(double sp,
                               SightRead::Beat& reserved_burst_size) const;
 
@@ -136,6 +151,17 @@ public:
     SpData(const SightRead::NoteTrack& track,
            const SpDurationData& duration_data,
            const PathingSettings& pathing_settings);
+    // A copy's initial guesses point into its own sustains.
+    SpData(const SpData& other);
+    SpData(SpData&& other) = default;
+    SpData& operator=(const SpData& other) = delete;
+    SpData& operator=(SpData&& other) = default;
+    ~SpData() = default;
+    // Recomputes the whammy ranges for a new early whammy, lazy whammy and
+    // video lag. The track, engine and drum settings must be those the SpData
+    // was made with.
+    void apply_timing_settings(const SightRead::NoteTrack& track,
+                               const PathingSettings& pathing_settings);
     // Return the maximum amount of SP available at the end after propagating
     // over a range, or -1 if SP runs out at any point. Only includes SP gain
     // from whammy.
@@ -157,6 +183,19 @@ public:
     available_whammy(SightRead::Beat start, SightRead::Beat end,
                      SightRead::Tick note_pos
                      = SightRead::Tick {std::numeric_limits<int>::max()}) const;
+    // Return the fraction of the SP that whammying all of [start, end) would
+    // give that available_whammy gives, or 0 for an empty range or a track
+    // that cannot gain SP from whammy.
+    [[nodiscard]] double whammy_coverage(SightRead::Beat start,
+                                         SightRead::Beat end) const;
+    // Return the earliest beat such that available_whammy(start, beat,
+    // note_pos) is sp, or infinity if there is never that much whammy. The
+    // whammy is piecewise linear, so this is found directly rather than by
+    // searching.
+    [[nodiscard]] SightRead::Beat earliest_whammy_end(
+        SightRead::Beat start, double sp,
+        SightRead::Tick note_pos
+        = SightRead::Tick {std::numeric_limits<int>::max()}) const;
     // Return how far an activation can propagate based on whammy, returning the
     // end of the range if it can be reached.
     [[nodiscard]] SpPosition activation_end_point(SpPosition start,
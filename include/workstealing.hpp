@@ -0,0 +1,198 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHOPT_WORKSTEALING_HPP
+#define CHOPT_WORKSTEALING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A deque of tasks belonging to one worker. The owner pushes and pops at the
+// back, so it works through its own tasks depth first, while other workers
+// steal from the front where the oldest and typically largest tasks are.
+template <typename Task> class WorkStealingDeque {
+private:
+    std::mutex m_mutex;
+    std::deque<Task> m_tasks;
+
+public:
+    void push(Task task)
+    {
+        const std::scoped_lock lock {m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+
+    std::optional<Task> pop()
+    {
+        const std::scoped_lock lock {m_mutex};
+        if (m_tasks.empty()) {
+            return std::nullopt;
+        }
+        auto task = std::move(m_tasks.back());
+        m_tasks.pop_back();
+        return task;
+    }
+
+    std::optional<Task> steal()
+    {
+        const std::scoped_lock lock {m_mutex};
+        if (m_tasks.empty()) {
+            return std::nullopt;
+        }
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        return task;
+    }
+};
+
+// Calls process(task, spawn) for every task, where spawn is a callable that
+// process can use to queue further tasks. Returns once every task, including
+// spawned ones, has been processed. If process throws then the remaining tasks
+// are abandoned and the first exception is rethrown on the calling thread.
+template <typename Task, typename F>
+void work_stealing_for_each(std::vector<Task> initial_tasks,
+                            unsigned int thread_count, F process)
+{
+    thread_count = std::max(thread_count, 1U);
+    std::vector<WorkStealingDeque<Task>> deques(thread_count);
+    std::atomic<std::size_t> pending_tasks {initial_tasks.size()};
+    std::atomic<bool> has_failed {false};
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+
+    for (auto i = 0U; i < initial_tasks.size(); ++i) {
+        deques.at(i % thread_count).push(std::move(initial_tasks.at(i)));
+    }
+
+    const auto next_task = [&](unsigned int worker) -> std::optional<Task> {
+        auto task = deques.at(worker).pop();
+        for (auto i = 1U; !task.has_value() && i < thread_count; ++i) {
+            task = deques.at((worker + i) % thread_count).steal();
+        }
+        return task;
+    };
+
+    const auto run_worker = [&](unsigned int worker) {
+        auto& own_deque = deques.at(worker);
+        const auto spawn = [&](Task task) {
+            pending_tasks.fetch_add(1, std::memory_order_relaxed);
+            own_deque.push(std::move(task));
+        };
+        while (pending_tasks.load() != 0 && !has_failed.load()) {
+            auto task = next_task(worker);
+            if (!task.has_value()) {
+                std::this_thread::yield();
+                continue;
+            }
+            try {
+                process(std::move(*task), spawn);
+            } catch (...) {
+                const std::scoped_lock lock {exception_mutex};
+                if (first_exception == nullptr) {
+                    first_exception = std::current_exception();
+                }
+                has_failed = true;
+            }
+            pending_tasks.fetch_sub(1);
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(thread_count - 1);
+        for (auto i = 1U; i < thread_count; ++i) {
+            threads.emplace_back(run_worker, i);
+        }
+        run_worker(0);
+    }
+
+    if (first_exception != nullptr) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+// Calls process(task) for every task on thread_count threads, starting tasks in
+// decreasing order of cost(task). Each thread takes the next task once it is
+// done with its last, so when the costs are roughly right the longest tasks
+// are not left until the end where they would keep one thread busy after the
+// rest are idle. Ties keep the order of tasks. If process throws then the
+// remaining tasks are abandoned and the first exception is rethrown on the
+// calling thread.
+template <typename Task, typename C, typename F>
+void longest_first_for_each(std::vector<Task> tasks, unsigned int thread_count,
+                            C cost, F process)
+{
+    thread_count = std::max(thread_count, 1U);
+    std::vector<double> costs;
+    costs.reserve(tasks.size());
+    for (const auto& task : tasks) {
+        costs.push_back(cost(task));
+    }
+    std::vector<std::size_t> order(tasks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater {},
+                             [&](auto index) { return costs.at(index); });
+
+    std::atomic<std::size_t> next_index {0};
+    std::atomic<bool> has_failed {false};
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+
+    const auto run_worker = [&] {
+        while (!has_failed.load()) {
+            const auto index = next_index.fetch_add(1);
+            if (index >= order.size()) {
+                return;
+            }
+            try {
+                process(std::move(tasks.at(order.at(index))));
+            } catch (...) {
+                const std::scoped_lock lock {exception_mutex};
+                if (first_exception == nullptr) {
+                    first_exception = std::current_exception();
+                }
+                has_failed = true;
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(thread_count - 1);
+        for (auto i = 1U; i < thread_count; ++i) {
+            threads.emplace_back(run_worker);
+        }
+        run_worker();
+    }
+
+    if (first_exception != nullptr) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+#endif
@@ -58,6 +58,7 @@ def actual_path_output(path):
                 str(path["early_whammy"]),
                 "--output",
                 f"{tempdir}/path.png",
+                *sys.argv[1:],
             ],
             capture_output=True,
         )
@@ -16,11 +16,19 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdint>
 #include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
 
 #include "imagebuilder.hpp"
 #include "optimiser.hpp"
+#include "workstealing.hpp"
 
 constexpr int MAX_BEATS_PER_LINE = 16;
 
@@ -294,6 +302,116 @@ song_unison_phrases(const SightRead::Song& song,
         throw std::runtime_error("Invalid UnisonBonusType");
     }
 }
+
+SightRead::NoteTrack prepare_track(SightRead::Song& song,
+                                   const SightRead::NoteTrack& track,
+                                   const Settings& settings)
+{
+    auto new_track
+        = track.snap_chords(settings.pathing_settings.engine->snap_gap());
+    if (track.track_type() == SightRead::TrackType::Drums) {
+        apply_drum_settings(new_track, song, settings.pathing_settings);
+    }
+    song.speedup(settings.speed);
+    return new_track;
+}
+
+// Returns nullptr if the track can be optimised.
+const char* optimisation_disabled_message(const SightRead::NoteTrack& track,
+                                          const Settings& settings)
+{
+    if (track.track_type() != SightRead::TrackType::Drums) {
+        return nullptr;
+    }
+    if (settings.pathing_settings.engine->is_rock_band()) {
+        return "Optimisation disabled for Rock Band drums, planned for a "
+               "future release";
+    }
+    if (settings.game == Game::Yarg) {
+        return "Optimisation disabled for YARG drums, planned for a future "
+               "release";
+    }
+    return nullptr;
+}
+
+// The returned callback writes the search's progress in steps of 10% with
+// its own copy of write, so it may outlive the caller's.
+std::function<void(int)>
+progress_writer(std::function<void(const char*)> write)
+{
+    constexpr int PROGRESS_STEP = 10;
+
+    return [write = std::move(write),
+            reported_percent = 0](int percent) mutable {
+        percent -= percent % PROGRESS_STEP;
+        if (percent > reported_percent) {
+            reported_percent = percent;
+            const auto progress
+                = "Optimising: " + std::to_string(percent) + "%";
+            write(progress.c_str());
+        }
+    };
+}
+
+Optimiser make_optimiser(const ProcessedSong& processed_track,
+                         const Settings& settings,
+                         const std::function<void(const char*)>& write,
+                         const std::atomic<bool>* terminate)
+{
+    Optimiser optimiser {&processed_track, terminate, settings.speed,
+                         settings.pathing_settings.whammy_delay,
+                         settings.optimiser_settings};
+    if (settings.optimiser_settings.report_progress) {
+        optimiser.set_progress_callback(progress_writer(write));
+    }
+    return optimiser;
+}
+
+// Every value is a number, so the JSON is written out directly.
+std::string search_stats_json(const GraphSearchStats& stats)
+{
+    const auto field = [](const std::string& name, const auto& value) {
+        return "\"" + name + "\": " + std::to_string(value);
+    };
+    return "{" + field("vertices", stats.graph_vertices) + ", "
+        + field("edges", stats.generated_edges) + ", "
+        + field("max_sp_edges", stats.max_sp_edges)
+        + ", \"candidate_checks\": {"
+        + field("success", stats.successful_candidates) + ", "
+        + field("insufficient_sp", stats.insufficient_sp_candidates) + ", "
+        + field("surplus_sp", stats.surplus_sp_candidates) + "}, "
+        + field("skipped_act_ends", stats.skipped_act_ends) + ", "
+        + field("candidate_cache_hits", stats.candidate_cache_hits) + ", "
+        + field("candidate_cache_misses", stats.candidate_cache_misses) + ", "
+        + field("arena_allocations", stats.arena_allocations) + ", "
+        + field("arena_blocks", stats.arena_blocks) + ", "
+        + field("graph_seconds", stats.graph_time.count()) + ", "
+        + field("path_seconds", stats.path_time.count()) + ", "
+        + field("max_score_loss", stats.max_score_loss) + "}";
+}
+
+void write_search_stats(const OptimiserSettings& settings,
+                        const GraphSearchStats& search_stats,
+                        const std::function<void(const char*)>& write)
+{
+    if (settings.branch_and_bound && settings.thread_count <= 1) {
+        const auto stats_summary = "Branch and bound: "
+            + std::to_string(search_stats.expanded_vertices)
+            + " vertices expanded, "
+            + std::to_string(search_stats.pruned_vertices) + " pruned";
+        write(stats_summary.c_str());
+    }
+    if (settings.approximation_tolerance > 0) {
+        const auto approximation_summary
+            = "Approximate search: path is at most "
+            + std::to_string(search_stats.max_score_loss)
+            + " points below optimal";
+        write(approximation_summary.c_str());
+    }
+    if (settings.report_stats) {
+        write(search_stats_json(search_stats).c_str());
+    }
+}
 }
 
 void ImageBuilder::form_beat_lines(const SightRead::TempoMap& tempo_map)
@@ -729,18 +847,11 @@ void ImageBuilder::set_total_score(const PointSet& points,
     m_total_score = no_sp_score + path.score_boost;
 }
 
-ImageBuilder make_builder(SightRead::Song& song,
-                          const SightRead::NoteTrack& track,
-                          const Settings& settings,
-                          const std::function<void(const char*)>& write,
-                          const std::atomic<bool>* terminate)
+namespace {
+ImageBuilder make_base_builder(const SightRead::Song& song,
+                               const SightRead::NoteTrack& new_track,
+                               const Settings& settings)
 {
-    auto new_track
-        = track.snap_chords(settings.pathing_settings.engine->snap_gap());
-    if (track.track_type() == SightRead::TrackType::Drums) {
-        apply_drum_settings(new_track, song, settings.pathing_settings);
-    }
-    song.speedup(settings.speed);
     const auto& tempo_map = song.global_data().tempo_map();
 
     auto builder = build_with_engine_params(new_track, settings);
@@ -748,7 +859,7 @@ ImageBuilder make_builder(SightRead::Song& song,
     builder.add_practice_sections(song.global_data().practice_sections(),
                                   tempo_map);
 
-    if (track.track_type() == SightRead::TrackType::Drums) {
+    if (new_track.track_type() == SightRead::TrackType::Drums) {
         builder.add_drum_fills(new_track);
     }
 
@@ -756,50 +867,113 @@ ImageBuilder make_builder(SightRead::Song& song,
         builder.add_bpms(tempo_map);
     }
 
-    const auto solos = new_track.solos(settings.pathing_settings.drum_settings);
     if (settings.draw_solos) {
-        builder.add_solo_sections(solos, tempo_map);
+        builder.add_solo_sections(
+            new_track.solos(settings.pathing_settings.drum_settings),
+            tempo_map);
     }
 
     if (settings.draw_time_sigs) {
         builder.add_time_sigs(tempo_map);
     }
 
-    const SpTimeMap time_map {tempo_map,
-                              settings.pathing_settings.engine->sp_mode()};
-    const auto unison_phrases = song_unison_phrases(
-        song, settings.pathing_settings.engine->unison_bonus_type());
-    const SpDurationData duration_data {.time_map = time_map,
-                                        .od_beats
-                                        = song.global_data().od_beats(),
-                                        .unison_phrases = unison_phrases};
+    return builder;
+}
 
-    const ProcessedSong processed_track {new_track, duration_data,
-                                         settings.pathing_settings};
+void add_path_values(ImageBuilder& builder,
+                     const SightRead::NoteTrack& new_track,
+                     const ProcessedSong& processed_track,
+                     const SightRead::TempoMap& tempo_map, const Path& path,
+                     const Settings& settings)
+{
+    builder.add_measure_values(processed_track.points(), tempo_map, path);
+    if (settings.blank || !settings.pathing_settings.engine->overlaps()) {
+        builder.add_sp_values(processed_track.sp_data(),
+                              *settings.pathing_settings.engine);
+    } else {
+        builder.add_sp_percent_values(
+            processed_track.sp_data(), processed_track.sp_time_map(),
+            processed_track.points(), path,
+            settings.pathing_settings.engine->sp_engine_values());
+    }
+    builder.set_total_score(
+        processed_track.points(),
+        new_track.solos(settings.pathing_settings.drum_settings), path);
+    if (settings.pathing_settings.engine->has_bres()) {
+        const auto& bres = new_track.bres();
+        if (!bres.empty()) {
+            builder.add_bre(bres.back(), tempo_map);
+        }
+    }
+}
+
+SpDurationData song_duration_data(const SightRead::Song& song,
+                                  const Settings& settings)
+{
+    return {.time_map = SpTimeMap {song.global_data().tempo_map(),
+                                   settings.pathing_settings.engine->sp_mode()},
+            .od_beats = song.global_data().od_beats(),
+            .unison_phrases = song_unison_phrases(
+                song, settings.pathing_settings.engine->unison_bonus_type())};
+}
+
+std::type_index engine_type(const Settings& settings)
+{
+    const auto& engine = *settings.pathing_settings.engine;
+    return typeid(engine);
+}
+
+// Finds the path with optimiser, unless settings.blank is set or the track
+// cannot be optimised, and adds it to builder.
+void add_path(ImageBuilder& builder, const SightRead::NoteTrack& new_track,
+              const SpDurationData& duration_data,
+              const ProcessedSong& processed_track, const Optimiser& optimiser,
+              const SightRead::TempoMap& tempo_map, const Settings& settings,
+              const std::function<void(const char*)>& write)
+{
+    const auto& unison_phrases = duration_data.unison_phrases;
     Path path;
 
     if (!settings.blank) {
-        const auto is_rb_drums
-            = track.track_type() == SightRead::TrackType::Drums
-            && settings.pathing_settings.engine->is_rock_band();
-        const auto is_yarg_drums
-            = track.track_type() == SightRead::TrackType::Drums
-            && settings.game == Game::Yarg;
-        if (is_rb_drums) {
-            write("Optimisation disabled for Rock Band drums, planned for a "
-                  "future release");
-            builder.add_sp_phrases(new_track, unison_phrases, path);
-        } else if (is_yarg_drums) {
-            write("Optimisation disabled for YARG drums, planned for a future "
-                  "release");
+        const auto* disabled_message
+            = optimisation_disabled_message(new_track, settings);
+        if (disabled_message != nullptr) {
+            write(disabled_message);
             builder.add_sp_phrases(new_track, unison_phrases, path);
         } else {
             write("Optimising, please wait...");
-            const Optimiser optimiser {&processed_track, terminate,
-                                       settings.speed,
-                                       settings.pathing_settings.whammy_delay};
-            path = optimiser.optimal_path();
+            const auto& optimiser_settings = settings.optimiser_settings;
+            GraphSearchStats search_stats;
+            std::vector<Path> alternative_paths;
+            if (optimiser_settings.time_limit.has_value()) {
+                const auto result = optimiser.anytime_path(&search_stats);
+                path = result.path;
+                if (!result.is_optimal) {
+                    write("Time limit reached, path may not be optimal");
+                }
+            } else if (optimiser_settings.alternative_paths > 0) {
+                auto paths = optimiser.best_paths(
+                    optimiser_settings.alternative_paths + 1,
+                    optimiser_settings.alternative_score_delta, &search_stats);
+                path = paths.front();
+                alternative_paths.assign(std::next(paths.begin()),
+                                         paths.end());
+            } else {
+                path = optimiser.optimal_path(&search_stats);
+            }
             write(processed_track.path_summary(path).c_str());
+            for (auto i = 0U; i < alternative_paths.size(); ++i) {
+                const auto& alternative = alternative_paths.at(i);
+                const auto heading = "Alternative " + std::to_string(i + 1)
+                    + ", "
+                    + std::to_string(path.score_boost
+                                     - alternative.score_boost)
+                    + " points behind:";
+                write(heading.c_str());
+                write(processed_track.score_summary(alternative).c_str());
+            }
+            write_search_stats(settings.optimiser_settings, search_stats,
+                               write);
             builder.add_sp_phrases(new_track, unison_phrases, path);
             builder.add_sp_acts(processed_track.points(), tempo_map, path);
             builder.activation_opacity() = settings.opacity;
@@ -808,22 +982,277 @@ ImageBuilder make_builder(SightRead::Song& song,
         builder.add_sp_phrases(new_track, unison_phrases, path);
     }
 
-    builder.add_measure_values(processed_track.points(), tempo_map, path);
-    if (settings.blank || !settings.pathing_settings.engine->overlaps()) {
-        builder.add_sp_values(processed_track.sp_data(),
-                              *settings.pathing_settings.engine);
+    add_path_values(builder, new_track, processed_track, tempo_map, path,
+                    settings);
+}
+}
+
+ImageBuilder make_builder(SightRead::Song& song,
+                          const SightRead::NoteTrack& track,
+                          const Settings& settings,
+                          const std::function<void(const char*)>& write,
+                          const std::atomic<bool>* terminate)
+{
+    const auto new_track = prepare_track(song, track, settings);
+    const auto& tempo_map = song.global_data().tempo_map();
+
+    auto builder = make_base_builder(song, new_track, settings);
+
+    const auto duration_data = song_duration_data(song, settings);
+    const ProcessedSong processed_track {new_track, duration_data,
+                                         settings.pathing_settings};
+    const auto optimiser
+        = make_optimiser(processed_track, settings, write, terminate);
+    add_path(builder, new_track, duration_data, processed_track, optimiser,
+             tempo_map, settings, write);
+
+    return builder;
+}
+
+PathingSession::PathingSession(SightRead::Song song, const Settings& settings,
+                               const std::atomic<bool>* terminate)
+    : m_song {std::move(song)}
+    , m_track {prepare_track(
+          m_song, m_song.track(settings.instrument, settings.difficulty),
+          settings)}
+    , m_duration_data {song_duration_data(m_song, settings)}
+    , m_processed_track {m_track, m_duration_data, settings.pathing_settings}
+    , m_optimiser {&m_processed_track, terminate, settings.speed,
+                   settings.pathing_settings.whammy_delay,
+                   settings.optimiser_settings}
+    , m_game {settings.game}
+    , m_instrument {settings.instrument}
+    , m_difficulty {settings.difficulty}
+    , m_speed {settings.speed}
+    , m_drum_settings {settings.pathing_settings.drum_settings}
+    , m_engine_type {engine_type(settings)}
+    , m_optimiser_settings {settings.optimiser_settings}
+{
+}
+
+bool PathingSession::can_find_path_for(const Settings& settings) const
+{
+    const auto& drum_settings = settings.pathing_settings.drum_settings;
+    return settings.game == m_game && settings.instrument == m_instrument
+        && settings.difficulty == m_difficulty && settings.speed == m_speed
+        && drum_settings.enable_double_kick
+        == m_drum_settings.enable_double_kick
+        && drum_settings.disable_kick == m_drum_settings.disable_kick
+        && drum_settings.pro_drums == m_drum_settings.pro_drums
+        && engine_type(settings) == m_engine_type
+        && settings.optimiser_settings == m_optimiser_settings;
+}
+
+ImageBuilder
+PathingSession::make_builder(const Settings& settings,
+                             const std::function<void(const char*)>& write,
+                             const std::function<void(int)>& progress)
+{
+    if (!can_find_path_for(settings)) {
+        throw std::invalid_argument(
+            "Settings differ from the session's in more than timing");
+    }
+
+    const auto& pathing_settings = settings.pathing_settings;
+    m_processed_track.apply_timing_settings(m_track, m_duration_data,
+                                            pathing_settings);
+    m_optimiser.apply_timing_settings(pathing_settings.whammy_delay);
+    if (progress) {
+        m_optimiser.set_progress_callback(progress);
+    } else if (settings.optimiser_settings.report_progress) {
+        m_optimiser.set_progress_callback(progress_writer(write));
     } else {
-        builder.add_sp_percent_values(
-            processed_track.sp_data(), time_map, processed_track.points(), path,
-            settings.pathing_settings.engine->sp_engine_values());
+        m_optimiser.set_progress_callback({});
     }
-    builder.set_total_score(processed_track.points(), solos, path);
-    if (settings.pathing_settings.engine->has_bres()) {
-        const auto& bres = new_track.bres();
-        if (!bres.empty()) {
-            builder.add_bre(bres.back(), tempo_map);
+
+    auto builder = make_base_builder(m_song, m_track, settings);
+    add_path(builder, m_track, m_duration_data, m_processed_track,
+             m_optimiser, m_song.global_data().tempo_map(), settings, write);
+    return builder;
+}
+
+std::vector<ImageBuilder>
+make_squeeze_sweep_builders(SightRead::Song& song,
+                            const SightRead::NoteTrack& track,
+                            Settings& settings,
+                            const std::function<void(const char*)>& write,
+                            const std::atomic<bool>* terminate)
+{
+    const auto& levels = settings.squeeze_sweep;
+    const auto new_track = prepare_track(song, track, settings);
+    const auto& tempo_map = song.global_data().tempo_map();
+    const auto base_builder = make_base_builder(song, new_track, settings);
+
+    const SpTimeMap time_map {tempo_map,
+                              settings.pathing_settings.engine->sp_mode()};
+    const auto unison_phrases = song_unison_phrases(
+        song, settings.pathing_settings.engine->unison_bonus_type());
+    const SpDurationData duration_data {.time_map = time_map,
+                                        .od_beats
+                                        = song.global_data().od_beats(),
+                                        .unison_phrases = unison_phrases};
+
+    auto& pathing_settings = settings.pathing_settings;
+    const auto default_squeeze = pathing_settings.squeeze;
+    const auto default_early_whammy = pathing_settings.early_whammy;
+
+    // The song is processed once and copied for each level, so only the hit
+    // windows and whammy ranges are worked out again.
+    std::vector<ProcessedSong> processed_tracks;
+    processed_tracks.reserve(levels.size());
+    for (const auto& level : levels) {
+        pathing_settings.squeeze = level.squeeze;
+        pathing_settings.early_whammy = level.early_whammy;
+        if (processed_tracks.empty()) {
+            processed_tracks.emplace_back(new_track, duration_data,
+                                          pathing_settings);
+        } else {
+            processed_tracks.push_back(processed_tracks.front());
+            processed_tracks.back().apply_timing_settings(
+                new_track, duration_data, pathing_settings);
+        }
+    }
+    pathing_settings.squeeze = default_squeeze;
+    pathing_settings.early_whammy = default_early_whammy;
+
+    std::vector<Path> paths(levels.size());
+    std::vector<GraphSearchStats> search_stats(levels.size());
+    std::vector<std::uint8_t> timed_out(levels.size(), 0);
+    const auto* disabled_message
+        = optimisation_disabled_message(track, settings);
+    if (disabled_message != nullptr) {
+        write(disabled_message);
+    } else {
+        write("Optimising, please wait...");
+        // The levels are independent, so as many are optimised at once as the
+        // hardware has threads for, or as thread_count asks for if that is
+        // more, each with an even share of thread_count. In low memory mode
+        // they are optimised one at a time so only one graph is kept.
+        auto optimiser_settings = settings.optimiser_settings;
+        const auto level_count = static_cast<unsigned int>(levels.size());
+        const auto hardware_threads
+            = std::max(std::thread::hardware_concurrency(), 1U);
+        const auto concurrent_levels = optimiser_settings.low_memory
+            ? 1U
+            : std::min(std::max(optimiser_settings.thread_count,
+                                hardware_threads),
+                       level_count);
+        optimiser_settings.thread_count = std::max(
+            optimiser_settings.thread_count / concurrent_levels, 1U);
+        std::vector<std::size_t> level_indices(levels.size());
+        std::iota(level_indices.begin(), level_indices.end(), 0);
+        work_stealing_for_each(
+            std::move(level_indices), concurrent_levels,
+            [&](std::size_t index, const auto& /*spawn*/) {
+                const Optimiser optimiser {
+                    &processed_tracks.at(index), terminate, settings.speed,
+                    pathing_settings.whammy_delay, optimiser_settings};
+                auto& stats = search_stats.at(index);
+                if (optimiser_settings.time_limit.has_value()) {
+                    const auto result = optimiser.anytime_path(&stats);
+                    paths.at(index) = result.path;
+                    timed_out.at(index) = result.is_optimal ? 0 : 1;
+                } else {
+                    paths.at(index) = optimiser.optimal_path(&stats);
+                }
+            });
+    }
+
+    std::vector<ImageBuilder> builders;
+    builders.reserve(levels.size());
+    for (auto i = 0U; i < levels.size(); ++i) {
+        const auto& processed_track = processed_tracks.at(i);
+        const auto& path = paths.at(i);
+        const auto heading
+            = "Squeeze " + std::to_string(levels.at(i).percent) + "%:";
+        write(heading.c_str());
+        if (disabled_message == nullptr) {
+            if (timed_out.at(i) != 0) {
+                write("Time limit reached, path may not be optimal");
+            }
+            write(processed_track.path_summary(path).c_str());
+            write_search_stats(settings.optimiser_settings, search_stats.at(i),
+                               write);
         }
+        auto& builder = builders.emplace_back(base_builder);
+        builder.add_sp_phrases(new_track, unison_phrases, path);
+        if (disabled_message == nullptr) {
+            builder.add_sp_acts(processed_track.points(), tempo_map, path);
+            builder.activation_opacity() = settings.opacity;
+        }
+        add_path_values(builder, new_track, processed_track, tempo_map, path,
+                        settings);
     }
 
-    return builder;
+    return builders;
+}
+
+RuntimeFeatures runtime_features(const SightRead::NoteTrack& track)
+{
+    const auto& notes = track.notes();
+    RuntimeFeatures features {.point_count = notes.size(),
+                              .phrase_count = track.sp_phrases().size(),
+                              .whammy_coverage = 0.0,
+                              .sustain_density = 0.0};
+    if (notes.empty()) {
+        return features;
+    }
+
+    std::size_t sustain_count = 0;
+    double sustained_ticks = 0.0;
+    for (const auto& note : notes) {
+        const auto length = std::ranges::max_element(note.lengths)->value();
+        if (length > 0) {
+            ++sustain_count;
+            sustained_ticks += length;
+        }
+    }
+    features.sustain_density = static_cast<double>(sustain_count)
+        / static_cast<double>(notes.size());
+    const auto span
+        = (notes.back().position - notes.front().position).value();
+    if (span > 0) {
+        features.whammy_coverage = std::min(sustained_ticks / span, 1.0);
+    }
+    return features;
+}
+
+void write_optimal_score(SightRead::Song& song,
+                         const SightRead::NoteTrack& track,
+                         const Settings& settings,
+                         const std::function<void(const char*)>& write,
+                         const std::atomic<bool>* terminate)
+{
+    const auto new_track = prepare_track(song, track, settings);
+    const SpTimeMap time_map {song.global_data().tempo_map(),
+                              settings.pathing_settings.engine->sp_mode()};
+    const SpDurationData duration_data {
+        .time_map = time_map,
+        .od_beats = song.global_data().od_beats(),
+        .unison_phrases = song_unison_phrases(
+            song, settings.pathing_settings.engine->unison_bonus_type())};
+    const ProcessedSong processed_track {new_track, duration_data,
+                                         settings.pathing_settings};
+
+    Path path;
+    const auto* disabled_message
+        = optimisation_disabled_message(track, settings);
+    if (disabled_message != nullptr) {
+        write(disabled_message);
+    } else {
+        const auto optimiser
+            = make_optimiser(processed_track, settings, write, terminate);
+        GraphSearchStats search_stats;
+        if (settings.optimiser_settings.time_limit.has_value()) {
+            const auto result = optimiser.anytime_path(&search_stats);
+            path = result.path;
+            if (!result.is_optimal) {
+                write("Time limit reached, score may not be optimal");
+            }
+        } else {
+            path = optimiser.optimal_score(&search_stats);
+        }
+        write_search_stats(settings.optimiser_settings, search_stats, write);
+    }
+    write(processed_track.score_summary(path).c_str());
 }
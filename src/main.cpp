@@ -16,8 +16,30 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <exception>
+#include <filesystem>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
 #include <QCoreApplication>
 #include <QTextStream>
@@ -27,6 +49,176 @@
 #include "image.hpp"
 #include "settings.hpp"
 #include "songfile.hpp"
+#include "workstealing.hpp"
+
+namespace {
+// Inserts _sqz<percent> before the file's extension, so out.d/path.png
+// becomes out.d/path_sqz50.png. from_args has already checked that the file
+// name has a stem and an extension.
+std::string squeeze_sweep_image_path(const std::string& image_path,
+                                     int percent)
+{
+    std::filesystem::path path {image_path};
+    auto filename = path.stem();
+    filename += "_sqz" + std::to_string(percent);
+    filename += path.extension();
+    path.replace_filename(filename);
+    return path.string();
+}
+
+// Returns the most memory the process has had resident, or nullopt if this is
+// not known on the platform.
+std::optional<std::size_t> peak_resident_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+        == 0) {
+        return std::nullopt;
+    }
+    return counters.PeakWorkingSetSize;
+#elif defined(__unix__) || defined(__APPLE__)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return std::nullopt;
+    }
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    constexpr std::size_t BYTES_PER_KIB = 1024;
+    return static_cast<std::size_t>(usage.ru_maxrss) * BYTES_PER_KIB;
+#endif
+#else
+    return std::nullopt;
+#endif
+}
+
+void write_peak_memory(const Settings& settings, QTextStream& stream)
+{
+    constexpr std::size_t BYTES_PER_MIB = 1024 * 1024;
+
+    if (!settings.optimiser_settings.report_peak_memory) {
+        return;
+    }
+    const auto peak_bytes = peak_resident_bytes();
+    if (!peak_bytes.has_value()) {
+        stream << "Peak memory: unknown on this platform\n";
+        return;
+    }
+    stream << "Peak memory: "
+           << static_cast<qulonglong>(*peak_bytes / BYTES_PER_MIB) << " MiB\n";
+}
+
+struct SetlistSong {
+    std::filesystem::path chart;
+    double predicted_cost;
+    // The song as loaded for predicting its cost, kept so it is only parsed
+    // once. Empty if it failed to load, with the exception in load_error.
+    std::optional<SightRead::Song> song;
+    std::exception_ptr load_error;
+};
+
+// Returns every chart in the setlist folder and its subfolders. Clone Hero
+// plays notes.mid over notes.chart when a song has both, so only notes.mid is
+// returned for those songs.
+std::vector<SetlistSong> setlist_songs(const std::string& setlist_path)
+{
+    std::vector<SetlistSong> songs;
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator {setlist_path}) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        const auto& path = entry.path();
+        if (path.filename() == "notes.mid"
+            || (path.filename() == "notes.chart"
+                && !std::filesystem::exists(path.parent_path()
+                                            / "notes.mid"))) {
+            songs.push_back({.chart = path,
+                             .predicted_cost = 0.0,
+                             .song = std::nullopt,
+                             .load_error = nullptr});
+        }
+    }
+    std::ranges::sort(songs, {}, &SetlistSong::chart);
+    return songs;
+}
+
+// Paths every song of the setlist, setlist_jobs songs at a time, starting
+// with the songs predicted to take longest so that one slow song does not hold
+// up the end of the run. Each song's output is written in one block once the
+// song is done, and a song that cannot be pathed does not stop the others.
+void run_setlist(const Settings& settings, QTextStream& stream,
+                 const std::atomic<bool>* terminate)
+{
+    const auto image_name
+        = std::filesystem::path {settings.image_path}.filename();
+    auto songs = setlist_songs(settings.setlist_path);
+
+    // Every song is loaded up front to predict its cost and kept until it is
+    // pathed. Songs that fail to load keep a cost of 0, and report their error
+    // when they are pathed.
+    std::vector<std::size_t> indices(songs.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    work_stealing_for_each(
+        std::move(indices), settings.setlist_jobs,
+        [&](std::size_t index, const auto& /*spawn*/) {
+            auto& setlist_song = songs.at(index);
+            try {
+                const SongFile song_file {setlist_song.chart.string()};
+                auto song = song_file.load_song(settings.game);
+                const auto& track
+                    = song.track(settings.instrument, settings.difficulty);
+                setlist_song.predicted_cost
+                    = runtime_features(track).predicted_cost();
+                setlist_song.song = std::move(song);
+            } catch (const std::exception&) {
+                setlist_song.predicted_cost = 0.0;
+                setlist_song.load_error = std::current_exception();
+            }
+        });
+
+    std::mutex stream_mutex;
+    longest_first_for_each(
+        std::move(songs), settings.setlist_jobs,
+        [](const auto& setlist_song) { return setlist_song.predicted_cost; },
+        [&](SetlistSong setlist_song) {
+            std::vector<std::string> lines;
+            const auto write = [&](const char* p) { lines.emplace_back(p); };
+            try {
+                if (!setlist_song.song.has_value()) {
+                    std::rethrow_exception(setlist_song.load_error);
+                }
+                auto& song = *setlist_song.song;
+                const auto& track
+                    = song.track(settings.instrument, settings.difficulty);
+                if (settings.score_only) {
+                    write_optimal_score(song, track, settings, write,
+                                        terminate);
+                } else {
+                    const auto builder = make_builder(song, track, settings,
+                                                      write, terminate);
+                    if (settings.draw_image) {
+                        const Image image {builder};
+                        const auto image_path
+                            = setlist_song.chart.parent_path() / image_name;
+                        image.save(image_path.string().c_str());
+                    }
+                }
+            } catch (const std::exception& e) {
+                lines.push_back(std::string {"Error: "} + e.what());
+            }
+
+            const std::scoped_lock lock {stream_mutex};
+            stream << QString::fromStdString(setlist_song.chart.string())
+                   << '\n';
+            for (const auto& line : lines) {
+                stream << line.c_str() << '\n';
+            }
+            stream.flush();
+        });
+}
+}
 
 int main(int argc, char** argv)
 {
@@ -38,16 +230,58 @@ int main(int argc, char** argv)
         QCoreApplication::setApplicationName("CHOpt");
         QCoreApplication::setApplicationVersion("1.15.2");
 
-        const auto settings
-            = from_args(QCoreApplication::arguments(), q_stderr);
+        auto settings = from_args(QCoreApplication::arguments(), q_stderr);
+        if (!settings.setlist_path.empty()) {
+            const std::atomic<bool> terminate {false};
+            run_setlist(settings, q_stdout, &terminate);
+            write_peak_memory(settings, q_stdout);
+            q_stdout.flush();
+            return EXIT_SUCCESS;
+        }
         const SongFile song_file {settings.filename};
         auto song = song_file.load_song(settings.game);
         const auto& track
             = song.track(settings.instrument, settings.difficulty);
-        const std::atomic<bool> terminate {false};
-        const auto builder = make_builder(
-            song, track, settings, [&](auto p) { q_stdout << p << '\n'; },
-            &terminate);
+        std::atomic<bool> terminate {false};
+        std::jthread deadline_timer;
+        const auto& time_limit = settings.optimiser_settings.time_limit;
+        if (time_limit.has_value()) {
+            deadline_timer = std::jthread {[&](const std::stop_token& token) {
+                std::mutex mutex;
+                std::condition_variable_any timer;
+                std::unique_lock lock {mutex};
+                timer.wait_for(lock, token, *time_limit, [] { return false; });
+                if (!token.stop_requested()) {
+                    terminate = true;
+                }
+            }};
+        }
+        const auto write = [&](const char* p) { q_stdout << p << '\n'; };
+        if (settings.score_only) {
+            write_optimal_score(song, track, settings, write, &terminate);
+            write_peak_memory(settings, q_stdout);
+            q_stdout.flush();
+            return EXIT_SUCCESS;
+        }
+        if (!settings.squeeze_sweep.empty()) {
+            const auto builders = make_squeeze_sweep_builders(
+                song, track, settings, write, &terminate);
+            write_peak_memory(settings, q_stdout);
+            q_stdout.flush();
+            if (settings.draw_image) {
+                for (auto i = 0U; i < builders.size(); ++i) {
+                    const Image image {builders.at(i)};
+                    const auto image_path = squeeze_sweep_image_path(
+                        settings.image_path,
+                        settings.squeeze_sweep.at(i).percent);
+                    image.save(image_path.c_str());
+                }
+            }
+            return EXIT_SUCCESS;
+        }
+        const auto builder
+            = make_builder(song, track, settings, write, &terminate);
+        write_peak_memory(settings, q_stdout);
         q_stdout.flush();
         if (settings.draw_image) {
             const Image image {builder};
@@ -16,17 +16,103 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
 #include <iterator>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
+#include "arena.hpp"
 #include "optimiser.hpp"
+#include "workstealing.hpp"
+
+namespace {
+// Returns a value within tolerance of the boundary between where is_valid
+// holds and where it does not, on the valid side, where is_valid(valid_end)
+// holds and is_valid is monotone between the ends. Most activations need no
+// squeeze or forced whammy, so the whole range is tried first and then
+// invalid_end is returned exactly.
+template <typename P>
+double valid_boundary(double valid_end, double invalid_end, P is_valid,
+                      double tolerance)
+{
+    if (is_valid(invalid_end)) {
+        return invalid_end;
+    }
+    while (std::abs(invalid_end - valid_end) > tolerance) {
+        const auto mid = (valid_end + invalid_end) / 2;
+        if (is_valid(mid)) {
+            valid_end = mid;
+        } else {
+            invalid_end = mid;
+        }
+    }
+    return valid_end;
+}
+
+// Passes on how far through the song the search has got as a whole
+// percentage, only calling the callback when the percentage goes up.
+class ProgressTracker {
+private:
+    const std::function<void(int)>& m_callback;
+    PointPtr m_first_point;
+    std::ptrdiff_t m_point_count;
+    std::atomic<int> m_percent {-1};
+    std::mutex m_mutex;
+
+public:
+    ProgressTracker(const std::function<void(int)>& callback,
+                    const PointSet& points)
+        : m_callback {callback}
+        , m_first_point {points.cbegin()}
+        , m_point_count {std::distance(points.cbegin(), points.cend())}
+    {
+    }
+
+    void update(PointPtr point)
+    {
+        if (!m_callback || m_point_count == 0) {
+            return;
+        }
+        constexpr std::ptrdiff_t MAX_PERCENT = 100;
+        const auto percent = static_cast<int>(
+            std::distance(m_first_point, point) * MAX_PERCENT / m_point_count);
+        if (percent <= m_percent.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const std::scoped_lock lock {m_mutex};
+        if (percent <= m_percent.load(std::memory_order_relaxed)) {
+            return;
+        }
+        m_percent.store(percent, std::memory_order_relaxed);
+        m_callback(percent);
+    }
+};
+}
 
 Optimiser::Optimiser(const ProcessedSong* song,
                      const std::atomic<bool>* terminate, int speed,
                      SightRead::Second whammy_delay)
+    : Optimiser {song, terminate, speed, whammy_delay, OptimiserSettings {}}
+{
+}
+
+Optimiser::Optimiser(const ProcessedSong* song,
+                     const std::atomic<bool>* terminate, int speed,
+                     SightRead::Second whammy_delay,
+                     OptimiserSettings settings)
     : m_song {song}
     , m_terminate {terminate}
+    , m_settings {settings}
     , m_drum_fill_delay {BASE_DRUM_FILL_DELAY / speed}
     , m_whammy_delay {whammy_delay}
 {
@@ -34,10 +120,39 @@ Optimiser::Optimiser(const ProcessedSong* song,
         throw std::invalid_argument(
             "Optimiser ctor's arguments must be non-null");
     }
+    set_next_candidate_points();
+
+    const auto& points = m_song->points();
+    const auto capacity = std::distance(points.cbegin(), points.cend()) + 1;
+    const auto& sp_engine_values = m_song->sp_engine_values();
+    m_remaining_phrase_sp.resize(static_cast<std::size_t>(capacity), 0.0);
+    for (auto i = static_cast<std::size_t>(capacity - 1); i > 0; --i) {
+        const auto& point = *std::next(points.cbegin(),
+                                       static_cast<std::ptrdiff_t>(i - 1));
+        auto phrase_sp = 0.0;
+        if (point.is_unison_sp_granting_note) {
+            phrase_sp = sp_engine_values.unison_phrase_amount;
+        } else if (point.is_sp_granting_note) {
+            phrase_sp = sp_engine_values.phrase_amount;
+        }
+        m_remaining_phrase_sp.at(i - 1)
+            = m_remaining_phrase_sp.at(i) + phrase_sp;
+    }
+}
+
+void Optimiser::apply_timing_settings(SightRead::Second whammy_delay)
+{
+    m_whammy_delay = whammy_delay;
+    set_next_candidate_points();
+}
+
+void Optimiser::set_next_candidate_points()
+{
     const auto& points = m_song->points();
     const auto& sp_data = m_song->sp_data();
 
     const auto capacity = std::distance(points.cbegin(), points.cend()) + 1;
+    m_next_candidate_points.clear();
     m_next_candidate_points.reserve(static_cast<std::size_t>(capacity));
     int count = 0;
     for (const auto* p = points.cbegin(); p < points.cend(); ++p) {
@@ -58,23 +173,423 @@ Optimiser::Optimiser(const ProcessedSong* song,
     }
 }
 
-Path Optimiser::optimal_path() const
+Path Optimiser::optimal_path(GraphSearchStats* stats) const
+{
+    if (!m_settings.verify_dominated_vertices) {
+        return optimal_path(m_settings, stats);
+    }
+
+    auto full_settings = m_settings;
+    full_settings.merge_dominated_vertices = false;
+    auto merged_settings = m_settings;
+    merged_settings.merge_dominated_vertices = true;
+
+    auto path = optimal_path(full_settings, stats);
+    const auto merged_path = optimal_path(merged_settings, nullptr);
+    if (merged_path.score_boost != path.score_boost) {
+        throw std::runtime_error(
+            "Merging dominated vertices gave a score boost of "
+            + std::to_string(merged_path.score_boost) + " instead of "
+            + std::to_string(path.score_boost));
+    }
+    return path;
+}
+
+void Optimiser::set_progress_callback(std::function<void(int)> callback)
+{
+    m_progress_callback = std::move(callback);
+}
+
+AnytimePath Optimiser::anytime_path(GraphSearchStats* stats) const
+{
+    AnytimePath result {.path = heuristic_path(), .is_optimal = false};
+    // With one thread, branch and bound can stop with the best path it has
+    // found so far. It keeps the same optimal path, so it is always used.
+    auto settings = m_settings;
+    if (settings.thread_count <= 1) {
+        settings.branch_and_bound = true;
+    }
+    GraphSearchStats search_stats;
+    try {
+        auto is_complete = true;
+        const auto graph = path_graph(root_vertex(), settings, search_stats, 0,
+                                      &is_complete);
+        // Reading the path off a finished graph is quick, so it is done even
+        // if time is up by now.
+        const auto path_start = std::chrono::steady_clock::now();
+        auto path = optimal_path_from_graph(graph, nullptr);
+        search_stats.path_time = std::chrono::steady_clock::now() - path_start;
+        if (is_complete) {
+            result = {.path = std::move(path), .is_optimal = true};
+        } else if (path.score_boost > result.path.score_boost) {
+            result.path = std::move(path);
+        }
+    } catch (const OptimisationCancelled&) {
+        // Searches with several threads cannot stop early with a graph, so
+        // the heuristic path is the best we have.
+    }
+    if (stats != nullptr) {
+        *stats = search_stats;
+    }
+    return result;
+}
+
+Path Optimiser::optimal_score(GraphSearchStats* stats) const
+{
+    GraphSearchStats search_stats;
+    const auto graph = path_graph(root_vertex(), m_settings, search_stats);
+    const auto path_start = std::chrono::steady_clock::now();
+    auto path = optimal_score_from_graph(graph);
+    search_stats.path_time = std::chrono::steady_clock::now() - path_start;
+    if (stats != nullptr) {
+        *stats = search_stats;
+    }
+    return path;
+}
+
+std::vector<Path> Optimiser::best_paths(std::size_t count, int score_delta,
+                                        GraphSearchStats* stats) const
+{
+    // A path being explored, stored as its last edge and the path before it.
+    struct PartialPath {
+        std::size_t parent;
+        const OptimiserGraph::Edge* edge;
+        OptimiserGraph::VertexId vertex_id;
+        int weight;
+    };
+
+    GraphSearchStats search_stats;
+    const auto graph
+        = path_graph(root_vertex(), m_settings, search_stats, score_delta);
+    const auto path_start = std::chrono::steady_clock::now();
+
+    // The graph holds every path within score_delta of the optimal one, and
+    // the optimal subpath value of each vertex is exact, so exploring paths
+    // best-first by weight plus that value finishes them in order of their
+    // score boost. Ties go to the latest path, and out edges are queued in
+    // reverse, so the first path finished follows the first out edges just
+    // as optimal_path_from_graph does.
+    const auto optimal_value
+        = *graph.optimal_subpath_value(graph.root_vertex_id());
+    std::vector<PartialPath> partial_paths;
+    partial_paths.push_back({.parent = 0,
+                             .edge = nullptr,
+                             .vertex_id = graph.root_vertex_id(),
+                             .weight = 0});
+    std::priority_queue<std::tuple<int, std::size_t>> queue;
+    queue.emplace(optimal_value, 0);
+
+    std::vector<Path> paths;
+    std::set<std::vector<std::tuple<PointPtr, PointPtr>>> seen_act_points;
+    while (paths.size() < count && !queue.empty()) {
+        throw_if_cancelled(m_terminate);
+        const auto index = std::get<1>(queue.top());
+        queue.pop();
+        const auto partial_path = partial_paths.at(index);
+        const auto out_edges = graph.out_edges(partial_path.vertex_id);
+        for (auto iter = out_edges.rbegin(); iter != out_edges.rend(); ++iter) {
+            const auto weight = partial_path.weight + iter->weight;
+            const auto bound
+                = weight + *graph.optimal_subpath_value(iter->dest_vertex_id);
+            if (bound < optimal_value - score_delta) {
+                continue;
+            }
+            queue.emplace(bound, partial_paths.size());
+            partial_paths.push_back({.parent = index,
+                                     .edge = &*iter,
+                                     .vertex_id = iter->dest_vertex_id,
+                                     .weight = weight});
+        }
+        if (!out_edges.empty()) {
+            continue;
+        }
+
+        std::vector<OptimiserGraph::Edge> edges;
+        for (auto i = index; i != 0; i = partial_paths.at(i).parent) {
+            edges.push_back(*partial_paths.at(i).edge);
+        }
+        std::ranges::reverse(edges);
+        auto path = path_along_edges(graph, edges, m_terminate);
+        // Paths through different vertices can still give the same
+        // activations, which are not worth listing twice.
+        std::vector<std::tuple<PointPtr, PointPtr>> act_points;
+        for (const auto& act : path.activations) {
+            act_points.emplace_back(act.act_start, act.act_end);
+        }
+        if (seen_act_points.insert(std::move(act_points)).second) {
+            paths.push_back(std::move(path));
+        }
+    }
+
+    search_stats.path_time = std::chrono::steady_clock::now() - path_start;
+    if (stats != nullptr) {
+        *stats = search_stats;
+    }
+    return paths;
+}
+
+PathGraphVertex Optimiser::root_vertex() const
 {
     PathGraphVertex vertex {.point = m_song->points().cbegin(),
                             .position = {.beat = SightRead::Beat(NEG_INF),
                                          .sp_measure = SpMeasure(NEG_INF)},
                             .is_max_sp_vertex = false};
-    const auto root_vertex = advance_graph_vertex(vertex);
+    return advance_graph_vertex(vertex);
+}
 
-    const auto graph = path_graph(root_vertex);
-    return optimal_path_from_graph(graph);
+// Follows the first out edge of each vertex, which is the shortest activation
+// from the earliest point with enough SP. This takes one out_edges call per
+// activation, so is far quicker than finding the optimal path. If the search
+// is cancelled part way, the path stops at the last vertex reached.
+Path Optimiser::heuristic_path() const
+{
+    Arena arena;
+    CandidateCache cache {0};
+    OutEdgeCounts counts;
+    OptimiserGraph graph {root_vertex()};
+    std::vector<OptimiserGraph::VertexId> vertex_ids {graph.root_vertex_id()};
+
+    try {
+        while (true) {
+            arena.reset();
+            auto edges
+                = out_edges(graph.vertex_property(vertex_ids.back()), &arena,
+                            &arena, cache, counts, m_terminate);
+            if (edges.begin() == edges.end()) {
+                break;
+            }
+            const auto& edge = *edges.begin();
+            const auto [dest_id, inserted]
+                = graph.insert_vertex(edge.dest_vertex);
+            if (!inserted) {
+                break;
+            }
+            graph.add_edge(vertex_ids.back(), dest_id, edge.weight,
+                           edge.activations);
+            vertex_ids.push_back(dest_id);
+        }
+    } catch (const OptimisationCancelled&) {
+        // The walk so far is still a path.
+    }
+
+    for (auto iter = vertex_ids.rbegin(); iter != vertex_ids.rend(); ++iter) {
+        graph.prune_suboptimal_out_edges(*iter);
+    }
+    return optimal_path_from_graph(graph, nullptr);
+}
+
+Path Optimiser::optimal_path(const OptimiserSettings& settings,
+                             GraphSearchStats* stats) const
+{
+    GraphSearchStats search_stats;
+    const auto graph = path_graph(root_vertex(), settings, search_stats);
+    const auto path_start = std::chrono::steady_clock::now();
+    auto path = optimal_path_from_graph(graph, m_terminate);
+    search_stats.path_time = std::chrono::steady_clock::now() - path_start;
+    if (stats != nullptr) {
+        *stats = search_stats;
+    }
+    return path;
+}
+
+void Optimiser::OutEdgeCounts::add(const OutEdgeCounts& other)
+{
+    generated_edges += other.generated_edges;
+    max_sp_edges += other.max_sp_edges;
+    successful_candidates += other.successful_candidates;
+    insufficient_sp_candidates += other.insufficient_sp_candidates;
+    surplus_sp_candidates += other.surplus_sp_candidates;
+    skipped_act_ends += other.skipped_act_ends;
 }
 
-OptimiserGraph Optimiser::path_graph(PathGraphVertex root_vertex) const
+void Optimiser::OutEdgeCounts::write_to(GraphSearchStats& stats) const
 {
-    auto F = [&](auto& graph, auto vertex) { return out_edges(graph, vertex); };
-    return generate_optimal_graph<PathGraphVertex, std::vector<ProtoActivation>,
-                                  decltype(F)>(root_vertex, F);
+    stats.generated_edges = generated_edges;
+    stats.max_sp_edges = max_sp_edges;
+    stats.successful_candidates = successful_candidates;
+    stats.insufficient_sp_candidates = insufficient_sp_candidates;
+    stats.surplus_sp_candidates = surplus_sp_candidates;
+    stats.skipped_act_ends = skipped_act_ends;
+}
+
+OptimiserGraph Optimiser::path_graph(PathGraphVertex root_vertex,
+                                     const OptimiserSettings& settings,
+                                     GraphSearchStats& stats, int edge_slack,
+                                     bool* is_complete) const
+{
+    // Scratch data for a single vertex lives in an arena leased from a pool
+    // for the search, so each thread reuses the same few arenas and they are
+    // all freed when the search ends. The serial, low memory and bottom-up
+    // searches are done with a vertex's edges before they ask for the next
+    // vertex's, so their edges can go in an arena too. The other searches
+    // keep edges around, so theirs go on the heap.
+    const auto is_bounded = settings.thread_count <= 1
+        && (settings.branch_and_bound || settings.approximation_tolerance > 0);
+    const auto is_serial = settings.thread_count <= 1 && !is_bounded;
+    Arena edge_arena;
+    ArenaPool scratch_arenas;
+    CandidateCache candidate_cache {settings.candidate_cache_bytes};
+    // With the same next point, an earlier position means whammy counts from
+    // earlier and activations can start earlier, so the vertex can reach
+    // everything the later one can.
+    std::atomic<std::size_t> dominated_edges {0};
+    std::mutex counts_mutex;
+    OutEdgeCounts total_counts;
+    ProgressTracker progress {m_progress_callback, m_song->points()};
+    const auto graph_start = std::chrono::steady_clock::now();
+    auto F = [&](auto vertex) {
+        progress.update(vertex.point);
+        const auto scratch_lease = scratch_arenas.lease();
+        auto* edge_resource = std::pmr::get_default_resource();
+        if (is_serial) {
+            edge_arena.reset();
+            edge_resource = &edge_arena;
+        }
+        OutEdgeCounts counts;
+        auto edges = out_edges(vertex, &scratch_lease.arena(), edge_resource,
+                               candidate_cache, counts, m_terminate);
+        if (settings.merge_dominated_vertices) {
+            dominated_edges += edges.remove_dominated_edges(
+                [](const auto& v) {
+                    return std::tuple {v.point, v.is_max_sp_vertex};
+                },
+                [](const auto& v) { return v.position.beat.value(); });
+        }
+        counts.generated_edges = static_cast<std::size_t>(
+            std::distance(edges.begin(), edges.end()));
+        {
+            const std::scoped_lock lock {counts_mutex};
+            total_counts.add(counts);
+        }
+        return edges;
+    };
+    const auto graph = [&] {
+        if (is_bounded) {
+            auto G
+                = [&](auto vertex) { return remaining_score_bound(vertex); };
+            return generate_optimal_graph_bounded<PathGraphVertex,
+                                                  std::vector<ProtoActivation>,
+                                                  decltype(F), decltype(G)>(
+                root_vertex, F, G, stats, m_terminate, edge_slack,
+                settings.approximation_tolerance, is_complete);
+        }
+        if (settings.thread_count > 1) {
+            return generate_optimal_graph_parallel<
+                PathGraphVertex, std::vector<ProtoActivation>, decltype(F)>(
+                root_vertex, F, settings.thread_count,
+                full_sp_vertices(root_vertex), m_terminate, edge_slack);
+        }
+        auto G = [&](auto vertex) {
+            return static_cast<std::size_t>(
+                std::distance(m_song->points().cbegin(), vertex.point));
+        };
+        if (settings.low_memory) {
+            return generate_optimal_graph_low_memory<
+                PathGraphVertex, std::vector<ProtoActivation>, decltype(F),
+                decltype(G)>(root_vertex, F, G, m_terminate, edge_slack);
+        }
+        if (settings.bottom_up) {
+            return generate_optimal_graph_bottom_up<
+                PathGraphVertex, std::vector<ProtoActivation>, decltype(F),
+                decltype(G)>(root_vertex, F, G, m_terminate, edge_slack);
+        }
+        return generate_optimal_graph<PathGraphVertex,
+                                      std::vector<ProtoActivation>,
+                                      decltype(F)>(root_vertex, F,
+                                                    m_terminate, edge_slack);
+    }();
+    stats.graph_time = std::chrono::steady_clock::now() - graph_start;
+    stats.graph_vertices = graph.vertex_count();
+    total_counts.write_to(stats);
+    stats.dominated_edges = dominated_edges;
+    stats.arena_allocations
+        = scratch_arenas.allocation_count() + edge_arena.allocation_count();
+    stats.arena_blocks
+        = scratch_arenas.block_count() + edge_arena.block_count();
+    stats.candidate_cache_hits = candidate_cache.hits();
+    stats.candidate_cache_misses = candidate_cache.misses();
+    return graph;
+}
+
+// out_edges links a vertex to the first point where the bar is certainly full
+// with an edge to a full SP vertex, and the graph below a full SP vertex does
+// not depend on how it was reached. This returns the chain of full SP vertices
+// that out_edges will produce starting from vertex, without building the
+// graph, so that the parallel search can seed its threads with them.
+std::vector<PathGraphVertex>
+Optimiser::full_sp_vertices(PathGraphVertex vertex) const
+{
+    std::vector<PathGraphVertex> vertices;
+    const auto* end = m_song->points().cend();
+
+    while (vertex.point < end) {
+        const auto early_act_bound = earliest_fill_appearance(vertex);
+        SpBar sp_bar {0.0, 0.0, m_song->sp_engine_values()};
+        if (vertex.is_max_sp_vertex) {
+            sp_bar = {1.0, 1.0, m_song->sp_engine_values()};
+        }
+        const auto* p = std::next(vertex.point);
+        for (; p < end; ++p) {
+            const auto* prev_point = std::prev(p);
+            if (prev_point->is_sp_granting_note) {
+                if (prev_point->is_unison_sp_granting_note) {
+                    sp_bar.add_unison_phrase();
+                } else {
+                    sp_bar.add_phrase();
+                }
+            }
+            if (m_song->is_drums()
+                && (!p->fill_start.has_value()
+                    || p->fill_start < early_act_bound)) {
+                continue;
+            }
+            if (sp_bar.min() == 1.0 && prev_point->is_sp_granting_note) {
+                break;
+            }
+        }
+        if (p >= end) {
+            break;
+        }
+        vertex = {.point = p,
+                  .position = std::prev(p)->hit_window_start,
+                  .is_max_sp_vertex = true};
+        vertices.push_back(vertex);
+    }
+
+    return vertices;
+}
+
+// Every activation from a vertex only covers points at or after the vertex's
+// point, so the score of those points bounds the boost. If the remaining
+// phrases are not enough for an activation and there is no whammy left, then
+// the boost must be 0.
+int Optimiser::remaining_score_bound(PathGraphVertex vertex) const
+{
+    constexpr double SP_EPSILON = 1e-9;
+
+    const auto& points = m_song->points();
+    if (vertex.point >= points.cend()) {
+        return 0;
+    }
+    if (!vertex.is_max_sp_vertex) {
+        const auto index = std::distance(points.cbegin(), vertex.point);
+        const auto phrase_sp
+            = m_remaining_phrase_sp.at(static_cast<std::size_t>(index));
+        auto whammy_start = vertex.position.beat;
+        if (vertex.point != points.cbegin()) {
+            whammy_start = std::min(
+                whammy_start, std::prev(vertex.point)->hit_window_start.beat);
+        }
+        const auto has_whammy
+            = m_song->sp_data().next_whammy_point(whammy_start)
+            < SightRead::Beat {std::numeric_limits<double>::infinity()};
+        if (!has_whammy
+            && phrase_sp + SP_EPSILON
+                < m_song->sp_engine_values().minimum_to_activate) {
+            return 0;
+        }
+    }
+    return points.range_score(vertex.point, points.cend());
 }
 
 PointPtr Optimiser::next_candidate_point(PointPtr point) const
@@ -124,36 +639,55 @@ Optimiser::earliest_fill_appearance(PathGraphVertex vertex) const
         return SightRead::Second(0.0);
     }
 
-    int sp_count = 0;
-    for (const auto* p = vertex.point; p < m_song->points().cend(); ++p) {
-        if (p->is_sp_granting_note) {
-            ++sp_count;
-            if (sp_count == 2) {
-                return m_song->sp_time_map().to_seconds(
-                           p->hit_window_start.beat)
-                    + m_drum_fill_delay;
-            }
+    const auto& points = m_song->points();
+    const auto next_sp_note = [&](PointPtr point) {
+        if (point == points.cend()) {
+            return point;
         }
+        return points.next_sp_granting_note(point);
+    };
+    const auto* first_sp_note = next_sp_note(vertex.point);
+    if (first_sp_note == points.cend()) {
+        return SightRead::Second(0.0);
     }
-
-    return SightRead::Second(0.0);
+    const auto* second_sp_note = next_sp_note(std::next(first_sp_note));
+    if (second_sp_note == points.cend()) {
+        return SightRead::Second(0.0);
+    }
+    return m_song->sp_time_map().to_seconds(
+               second_sp_note->hit_window_start.beat)
+        + m_drum_fill_delay;
 }
 
 OutEdgeAggregate<PathGraphVertex, ProtoActivation>
-Optimiser::out_edges(OptimiserGraph& graph, std::size_t vertex_id) const
+Optimiser::out_edges(PathGraphVertex vertex,
+                     std::pmr::memory_resource* scratch,
+                     std::pmr::memory_resource* edge_resource,
+                     CandidateCache& cache, OutEdgeCounts& counts,
+                     const std::atomic<bool>* terminate) const
 {
-    const auto vertex = graph.vertex_property(vertex_id);
     const auto early_act_bound = earliest_fill_appearance(vertex);
-    ActivationEndSet<PointPtr> attained_act_ends {vertex.point,
-                                                  m_song->points().cend()};
+    ActivationEndSet<PointPtr> attained_act_ends {
+        vertex.point, m_song->points().cend(), scratch};
     auto lower_bound_set = false;
 
-    OutEdgeAggregate<PathGraphVertex, ProtoActivation> optimal_out_edges;
+    OutEdgeAggregate<PathGraphVertex, ProtoActivation> optimal_out_edges {
+        edge_resource};
+
+    // Drum activations can only start at the end of a fill, so only those
+    // points are visited.
+    const auto& points = m_song->points();
+    const auto next_start_point = [&](PointPtr point) {
+        if (!m_song->is_drums() || point == points.cend()) {
+            return point;
+        }
+        return points.next_fill_point(point);
+    };
 
-    for (const auto* p = vertex.point; p < m_song->points().cend(); ++p) {
-        if (m_song->is_drums()
-            && (!p->fill_start.has_value()
-                || p->fill_start < early_act_bound)) {
+    for (const auto* p = next_start_point(vertex.point); p < points.cend();
+         p = next_start_point(std::next(p))) {
+        throw_if_cancelled(terminate);
+        if (m_song->is_drums() && p->fill_start < early_act_bound) {
             continue;
         }
         SpBar sp_bar {1.0, 1.0, m_song->sp_engine_values()};
@@ -185,27 +719,21 @@ Optimiser::out_edges(OptimiserGraph& graph, std::size_t vertex_id) const
                                             = std::prev(p)->hit_window_start,
                                             .is_max_sp_vertex = true};
             optimal_out_edges.add_activation(full_sp_vertex, {}, 0);
+            ++counts.max_sp_edges;
             break;
         }
         // This skips some points that are too early to be an act end for the
         // earliest possible activation.
+        const auto* earliest_pt_end
+            = earliest_act_end_point(p, starting_pos, sp_bar);
         if (!lower_bound_set) {
-            const SpMeasure act_length {
-                8.0
-                * std::max(sp_bar.min(),
-                           m_song->sp_engine_values().minimum_to_activate)};
-            const auto earliest_act_end = starting_pos.sp_measure + act_length;
-            const auto* earliest_pt_end = std::find_if_not(
-                std::next(p), m_song->points().cend(), [&](const auto& pt) {
-                    return pt.hit_window_end.sp_measure <= earliest_act_end;
-                });
-            --earliest_pt_end;
             attained_act_ends = ActivationEndSet<PointPtr> {
-                earliest_pt_end, m_song->points().cend()};
+                earliest_pt_end, m_song->points().cend(), scratch};
             lower_bound_set = true;
         }
-        add_acts_from_starting_point(p, starting_pos, sp_bar, attained_act_ends,
-                                     optimal_out_edges);
+        add_acts_from_starting_point(p, starting_pos, sp_bar, earliest_pt_end,
+                                     attained_act_ends, optimal_out_edges,
+                                     cache, counts);
         if (p->is_sp_granting_note) {
             attained_act_ends.clear_temporary_elements();
         }
@@ -214,20 +742,55 @@ Optimiser::out_edges(OptimiserGraph& graph, std::size_t vertex_id) const
     return optimal_out_edges;
 }
 
+// An activation from starting_pos lasts at least as long as the SP it must
+// start with, so it cannot end at any point before the last one whose hit
+// window ends by then. Those points would all give surplus_sp. The point is
+// usually only a few after p, which first_window_end_after is quick to find.
+PointPtr Optimiser::earliest_act_end_point(PointPtr p, SpPosition starting_pos,
+                                           const SpBar& sp_bar) const
+{
+    const SpMeasure act_length {
+        8.0
+        * std::max(sp_bar.min(),
+                   m_song->sp_engine_values().minimum_to_activate)};
+    const auto earliest_act_end = starting_pos.sp_measure + act_length;
+    return std::prev(m_song->points().first_window_end_after(
+        std::next(p), earliest_act_end));
+}
+
 void Optimiser::add_acts_from_starting_point(
     PointPtr starting_point, SpPosition starting_pos, SpBar sp_bar,
-    ActivationEndSet<PointPtr>& attained_act_ends,
-    OutEdgeAggregate<PathGraphVertex, ProtoActivation>& optimal_out_edges) const
+    PointPtr earliest_act_end, ActivationEndSet<PointPtr>& attained_act_ends,
+    OutEdgeAggregate<PathGraphVertex, ProtoActivation>& optimal_out_edges,
+    CandidateCache& cache, OutEdgeCounts& counts) const
 {
+    const auto next_act_end = [&](PointPtr q) {
+        const auto* next = attained_act_ends.next_absent_element(q);
+        counts.skipped_act_ends
+            += static_cast<std::size_t>(std::distance(q, next) - 1);
+        return next;
+    };
+
     for (const auto* q = attained_act_ends.lowest_absent_element();
-         q < m_song->points().cend();
-         q = attained_act_ends.next_absent_element(q)) {
+         q < m_song->points().cend(); q = next_act_end(q)) {
+        // These act ends are known to give surplus_sp, so they are marked as
+        // they would be below without checking the candidate.
+        if (starting_point <= q && q < earliest_act_end) {
+            if (sp_bar.minimum_sufficient_to_activate()
+                || !act_contains_sp_phrase(starting_point, q)) {
+                attained_act_ends.add(q);
+            } else {
+                attained_act_ends.add_temporary_element(q);
+            }
+            continue;
+        }
         ActivationCandidate candidate {.act_start = starting_point,
                                        .act_end = q,
                                        .earliest_activation_point
                                        = starting_pos,
                                        .sp_bar = sp_bar};
-        const auto candidate_result = m_song->is_candidate_valid(candidate);
+        const auto candidate_result
+            = cached_candidate_result(candidate, cache, counts);
         switch (candidate_result.validity) {
         case ActValidity::insufficient_sp:
             // We cannot hit any later points if q is not a hold point, so we
@@ -266,62 +829,148 @@ void Optimiser::add_acts_from_starting_point(
     }
 }
 
-Path Optimiser::optimal_path_from_graph(const OptimiserGraph& graph) const
+ActResult
+Optimiser::cached_candidate_result(const ActivationCandidate& candidate,
+                                   CandidateCache& cache,
+                                   OutEdgeCounts& counts) const
 {
-    Path path {.activations = {}, .score_boost = 0};
-
-    std::size_t src_vertex_id = graph.root_vertex_id();
-    PathGraphVertex act_start_vertex = graph.vertex_property(src_vertex_id);
-    while (true) {
-        const auto& out_edges = graph.out_edges(src_vertex_id);
-        if (out_edges.empty()) {
+    const auto checked_result = [&] {
+        const auto result = m_song->is_candidate_valid(candidate);
+        switch (result.validity) {
+        case ActValidity::success:
+            ++counts.successful_candidates;
+            break;
+        case ActValidity::insufficient_sp:
+            ++counts.insufficient_sp_candidates;
+            break;
+        case ActValidity::surplus_sp:
+            ++counts.surplus_sp_candidates;
             break;
         }
+        return result;
+    };
+
+    if (!cache.is_enabled()) {
+        return checked_result();
+    }
+    const auto key = CandidateKey::make(candidate);
+    const auto cached_result = cache.find(key);
+    if (cached_result.has_value()) {
+        return *cached_result;
+    }
+    const auto result = checked_result();
+    cache.store(key, result);
+    return result;
+}
+
+Path Optimiser::optimal_path_from_graph(
+    const OptimiserGraph& graph, const std::atomic<bool>* terminate) const
+{
+    std::vector<OptimiserGraph::Edge> edges;
+    auto vertex_id = graph.root_vertex_id();
+    while (!graph.out_edges(vertex_id).empty()) {
+        edges.push_back(graph.out_edges(vertex_id).front());
+        vertex_id = edges.back().dest_vertex_id;
+    }
+    return path_along_edges(graph, edges, terminate);
+}
+
+// The edges must form a path from the root vertex.
+Path Optimiser::path_along_edges(const OptimiserGraph& graph,
+                                 std::span<const OptimiserGraph::Edge> edges,
+                                 const std::atomic<bool>* terminate) const
+{
+    struct ActivationEdge {
+        std::span<const ProtoActivation> proto_acts;
+        PathGraphVertex act_start_vertex;
+        PathGraphVertex act_end_vertex;
+    };
 
-        const auto& edge = out_edges.front();
-        const auto dest_vertex_id = edge.dest_vertex_id;
+    Path path {.activations = {}, .score_boost = 0};
+    std::vector<ActivationEdge> act_edges;
 
+    PathGraphVertex act_start_vertex
+        = graph.vertex_property(graph.root_vertex_id());
+    for (const auto& edge : edges) {
         path.score_boost += edge.weight;
 
-        const auto& acts = edge.property;
+        const auto acts = graph.edge_property(edge);
         if (acts.empty()) {
-            src_vertex_id = dest_vertex_id;
             continue;
         }
+        const auto act_end_vertex = graph.vertex_property(edge.dest_vertex_id);
+        act_edges.push_back({.proto_acts = acts,
+                             .act_start_vertex = act_start_vertex,
+                             .act_end_vertex = act_end_vertex});
+        act_start_vertex = act_end_vertex;
+    }
 
-        auto best_proto_act = acts.at(0);
-        auto best_sqz_level
-            = act_squeeze_level(best_proto_act, act_start_vertex);
-        for (auto i = 1U; i < acts.size(); ++i) {
-            const auto proto_act = acts.at(i);
-            const auto sqz_level
-                = act_squeeze_level(proto_act, act_start_vertex);
-            if (sqz_level < best_sqz_level) {
-                best_proto_act = proto_act;
-                best_sqz_level = sqz_level;
-            }
+    // Each activation only depends on its own edge and the vertices either
+    // side, so they are worked out in parallel and put in order afterwards.
+    path.activations.resize(act_edges.size());
+    std::vector<std::size_t> act_indices(act_edges.size());
+    std::iota(act_indices.begin(), act_indices.end(), 0);
+    const auto thread_count = std::min(
+        m_settings.thread_count, static_cast<unsigned int>(act_edges.size()));
+    work_stealing_for_each(
+        std::move(act_indices), thread_count,
+        [&](std::size_t index, const auto& /*spawn*/) {
+            throw_if_cancelled(terminate);
+            const auto& act_edge = act_edges.at(index);
+            path.activations.at(index) = best_activation(
+                act_edge.proto_acts, act_edge.act_start_vertex,
+                act_edge.act_end_vertex);
+        });
+
+    return path;
+}
+
+Activation
+Optimiser::best_activation(std::span<const ProtoActivation> acts,
+                           PathGraphVertex act_start_vertex,
+                           PathGraphVertex act_end_vertex) const
+{
+    auto best_proto_act = acts.front();
+    auto best_sqz_level = act_squeeze_level(best_proto_act, act_start_vertex);
+    for (const auto& proto_act : acts.subspan(1)) {
+        const auto sqz_level = act_squeeze_level(proto_act, act_start_vertex);
+        if (sqz_level < best_sqz_level) {
+            best_proto_act = proto_act;
+            best_sqz_level = sqz_level;
         }
-        const auto min_whammy_force = forced_whammy_end(
-            best_proto_act, act_start_vertex, best_sqz_level);
-        const auto [start_pos, end_pos] = act_duration(
-            best_proto_act, act_start_vertex, best_sqz_level, min_whammy_force);
-        Activation act {.act_start = best_proto_act.act_start,
-                        .act_end = best_proto_act.act_end,
-                        .whammy_end = min_whammy_force.beat,
-                        .sp_start = start_pos,
-                        .sp_end = end_pos};
-
-        const auto act_end_vertex = graph.vertex_property(dest_vertex_id);
-        if (act_end_vertex.point != m_song->points().cend()) {
-            const auto post_act_first_whammy
-                = m_song->sp_data().next_whammy_point(
-                    act_end_vertex.position.beat);
-            act.sp_end = std::min(act.sp_end, post_act_first_whammy);
-        }
-        path.activations.push_back(act);
-
-        src_vertex_id = dest_vertex_id;
-        act_start_vertex = act_end_vertex;
+    }
+    const auto min_whammy_force
+        = forced_whammy_end(best_proto_act, act_start_vertex, best_sqz_level);
+    const auto [start_pos, end_pos] = act_duration(
+        best_proto_act, act_start_vertex, best_sqz_level, min_whammy_force);
+    Activation act {.act_start = best_proto_act.act_start,
+                    .act_end = best_proto_act.act_end,
+                    .whammy_end = min_whammy_force.beat,
+                    .sp_start = start_pos,
+                    .sp_end = end_pos};
+
+    if (act_end_vertex.point != m_song->points().cend()) {
+        const auto post_act_first_whammy
+            = m_song->sp_data().next_whammy_point(act_end_vertex.position.beat);
+        act.sp_end = std::min(act.sp_end, post_act_first_whammy);
+    }
+    return act;
+}
+
+Path Optimiser::optimal_score_from_graph(const OptimiserGraph& graph) const
+{
+    Path path {.activations = {}, .score_boost = 0};
+
+    auto vertex_id = graph.root_vertex_id();
+    while (!graph.out_edges(vertex_id).empty()) {
+        const auto& edge = graph.out_edges(vertex_id).front();
+        path.score_boost += edge.weight;
+        const auto acts = graph.edge_property(edge);
+        if (!acts.empty()) {
+            path.activations.push_back({.act_start = acts.front().act_start,
+                                        .act_end = acts.front().act_end});
+        }
+        vertex_id = edge.dest_vertex_id;
     }
 
     return path;
@@ -332,14 +981,11 @@ double Optimiser::act_squeeze_level(ProtoActivation act,
 {
     constexpr double THRESHOLD = 0.01;
 
-    auto min_sqz = 0.0;
-    auto max_sqz = 1.0;
     // Determines what point controls how early we can go: the previous point on
     // guitar and the current point on drums.
     const auto* start_bound_point
         = m_song->is_drums() ? act.act_start : std::prev(act.act_start);
-    while (max_sqz - min_sqz > THRESHOLD) {
-        auto trial_sqz = (min_sqz + max_sqz) / 2;
+    const auto is_valid = [&](double trial_sqz) {
         auto start_pos
             = m_song->adjusted_hit_window_start(start_bound_point, trial_sqz);
         if (start_pos.beat < vertex.position.beat) {
@@ -355,14 +1001,10 @@ double Optimiser::act_squeeze_level(ProtoActivation act,
                                        .act_end = act.act_end,
                                        .earliest_activation_point = start_pos,
                                        .sp_bar = sp_bar};
-        if (m_song->is_candidate_valid(candidate, trial_sqz).validity
-            == ActValidity::success) {
-            max_sqz = trial_sqz;
-        } else {
-            min_sqz = trial_sqz;
-        }
-    }
-    return max_sqz;
+        return m_song->is_candidate_valid(candidate, trial_sqz).validity
+            == ActValidity::success;
+    };
+    return valid_boundary(1.0, 0.0, is_valid, THRESHOLD);
 }
 
 SpPosition Optimiser::forced_whammy_end(ProtoActivation act,
@@ -380,30 +1022,34 @@ SpPosition Optimiser::forced_whammy_end(ProtoActivation act,
     }
 
     const auto* prev_point = std::prev(act.act_start);
-    auto min_whammy_force = vertex.position;
-    auto max_whammy_force = next_point->hit_window_end;
     auto start_pos = m_song->adjusted_hit_window_start(prev_point, sqz_level);
-    while ((max_whammy_force.beat - min_whammy_force.beat).value()
-           > THRESHOLD) {
-        auto mid_beat
-            = (min_whammy_force.beat + max_whammy_force.beat) * (1.0 / 2);
-        auto mid_meas = m_song->sp_time_map().to_sp_measures(mid_beat);
-        SpPosition mid_pos {.beat = mid_beat, .sp_measure = mid_meas};
+    const auto is_valid = [&](double beat) {
+        const SightRead::Beat whammy_beat {beat};
+        const SpPosition whammy_pos {
+            .beat = whammy_beat,
+            .sp_measure = m_song->sp_time_map().to_sp_measures(whammy_beat)};
         auto sp_bar = m_song->total_available_sp(
-            vertex.position.beat, vertex.point, act.act_start, mid_beat);
+            vertex.position.beat, vertex.point, act.act_start, whammy_beat);
         ActivationCandidate candidate {.act_start = act.act_start,
                                        .act_end = act.act_end,
                                        .earliest_activation_point = start_pos,
                                        .sp_bar = sp_bar};
-        auto result = m_song->is_candidate_valid(candidate, sqz_level, mid_pos);
-        if (result.validity == ActValidity::success) {
-            min_whammy_force = mid_pos;
-        } else {
-            max_whammy_force = mid_pos;
-        }
+        return m_song->is_candidate_valid(candidate, sqz_level, whammy_pos)
+                   .validity
+            == ActValidity::success;
+    };
+    const auto whammy_force_beat = valid_boundary(
+        vertex.position.beat.value(), next_point->hit_window_end.beat.value(),
+        is_valid, THRESHOLD);
+    if (whammy_force_beat == vertex.position.beat.value()) {
+        return vertex.position;
     }
-
-    return min_whammy_force;
+    if (whammy_force_beat == next_point->hit_window_end.beat.value()) {
+        return next_point->hit_window_end;
+    }
+    const SightRead::Beat whammy_force {whammy_force_beat};
+    return {.beat = whammy_force,
+            .sp_measure = m_song->sp_time_map().to_sp_measures(whammy_force)};
 }
 
 std::tuple<SightRead::Beat, SightRead::Beat>
@@ -416,28 +1062,38 @@ Optimiser::act_duration(ProtoActivation act, PathGraphVertex vertex,
     // guitar and the current point on drums.
     const auto* start_bound_point
         = m_song->is_drums() ? act.act_start : std::prev(act.act_start);
-    auto min_pos
+    const auto earliest_pos
         = m_song->adjusted_hit_window_start(start_bound_point, sqz_level);
-    auto max_pos = m_song->adjusted_hit_window_end(act.act_start, sqz_level);
+    const auto latest_pos
+        = m_song->adjusted_hit_window_end(act.act_start, sqz_level);
     auto sp_bar
         = m_song->total_available_sp(vertex.position.beat, vertex.point,
                                      act.act_start, min_whammy_force.beat);
-    while ((max_pos.beat - min_pos.beat).value() > THRESHOLD) {
-        auto trial_beat = (min_pos.beat + max_pos.beat) * (1.0 / 2);
-        auto trial_meas = m_song->sp_time_map().to_sp_measures(trial_beat);
-        SpPosition trial_pos {.beat = trial_beat, .sp_measure = trial_meas};
+    const auto position_at = [&](double beat) -> SpPosition {
+        if (beat == earliest_pos.beat.value()) {
+            return earliest_pos;
+        }
+        if (beat == latest_pos.beat.value()) {
+            return latest_pos;
+        }
+        const SightRead::Beat trial_beat {beat};
+        return {.beat = trial_beat,
+                .sp_measure = m_song->sp_time_map().to_sp_measures(trial_beat)};
+    };
+    const auto is_valid = [&](double beat) {
         ActivationCandidate candidate {.act_start = act.act_start,
                                        .act_end = act.act_end,
-                                       .earliest_activation_point = trial_pos,
+                                       .earliest_activation_point
+                                       = position_at(beat),
                                        .sp_bar = sp_bar};
-        if (m_song->is_candidate_valid(candidate, sqz_level, min_whammy_force)
-                .validity
-            == ActValidity::success) {
-            min_pos = trial_pos;
-        } else {
-            max_pos = trial_pos;
-        }
-    }
+        return m_song->is_candidate_valid(candidate, sqz_level,
+                                          min_whammy_force)
+                   .validity
+            == ActValidity::success;
+    };
+    const auto min_pos = position_at(
+        valid_boundary(earliest_pos.beat.value(), latest_pos.beat.value(),
+                       is_valid, THRESHOLD));
 
     ActivationCandidate candidate {.act_start = act.act_start,
                                    .act_end = act.act_end,
@@ -21,6 +21,7 @@
 #include <cassert>
 #include <cmath>
 #include <iterator>
+#include <numeric>
 
 #include "points.hpp"
 
@@ -286,13 +287,29 @@ int clean_bonus_multiplier(const SightRead::Note& note,
     return get_chord_size(note, drum_settings);
 }
 
+void set_hit_window(Point& point, const NoteTiming& timing,
+                    const SpTimeMap& time_map, double squeeze)
+{
+    const SightRead::Second early_window {timing.early_window.value()
+                                          * squeeze};
+    const SightRead::Second late_window {timing.late_window.value() * squeeze};
+
+    const auto early_beat = time_map.to_beats(timing.time - early_window);
+    const auto early_meas = time_map.to_sp_measures(early_beat);
+    const auto late_beat = time_map.to_beats(timing.time + late_window);
+    const auto late_meas = time_map.to_sp_measures(late_beat);
+    point.position = timing.position;
+    point.hit_window_start = {.beat = early_beat, .sp_measure = early_meas};
+    point.hit_window_end = {.beat = late_beat, .sp_measure = late_meas};
+}
+
 template <typename OutputIt>
-void append_note_points(std::vector<SightRead::Note>::const_iterator note,
-                        const std::vector<SightRead::Note>& notes,
-                        OutputIt points, const SpTimeMap& time_map,
-                        int resolution, bool is_note_sp_ender,
-                        bool is_unison_sp_ender,
-                        const PathingSettings& pathing_settings)
+NoteTiming append_note_points(std::vector<SightRead::Note>::const_iterator note,
+                              const std::vector<SightRead::Note>& notes,
+                              OutputIt points, const SpTimeMap& time_map,
+                              int resolution, bool is_note_sp_ender,
+                              bool is_unison_sp_ender,
+                              const PathingSettings& pathing_settings)
 {
     auto note_value = pathing_settings.engine->base_note_value();
     if (note->flags & SightRead::FLAGS_DRUMS) {
@@ -325,26 +342,21 @@ void append_note_points(std::vector<SightRead::Note>::const_iterator note,
         late_gap = (next_note_seconds - note_seconds).value();
     }
 
-    const SightRead::Second early_window {
-        pathing_settings.engine->early_timing_window(early_gap, late_gap)
-        * pathing_settings.squeeze};
-    const SightRead::Second max_sqz_early_window {
-        pathing_settings.engine->early_timing_window(early_gap, late_gap)};
-    const SightRead::Second late_window {
-        pathing_settings.engine->late_timing_window(early_gap, late_gap)
-        * pathing_settings.squeeze};
+    const NoteTiming timing {
+        .position = {.beat = beat, .sp_measure = meas},
+        .time = note_seconds,
+        .early_window = SightRead::Second {
+            pathing_settings.engine->early_timing_window(early_gap, late_gap)},
+        .late_window = SightRead::Second {
+            pathing_settings.engine->late_timing_window(early_gap, late_gap)}};
 
-    const auto early_beat = time_map.to_beats(note_seconds - early_window);
-    const auto early_meas = time_map.to_sp_measures(early_beat);
     const auto early_max_sqz_beat
-        = time_map.to_beats(note_seconds - max_sqz_early_window);
+        = time_map.to_beats(note_seconds - timing.early_window);
     const auto early_max_sqz_meas = time_map.to_sp_measures(early_max_sqz_beat);
-    const auto late_beat = time_map.to_beats(note_seconds + late_window);
-    const auto late_meas = time_map.to_sp_measures(late_beat);
-    const Point note_point {
-        .position = {.beat = beat, .sp_measure = meas},
-        .hit_window_start = {.beat = early_beat, .sp_measure = early_meas},
-        .hit_window_end = {.beat = late_beat, .sp_measure = late_meas},
+    Point note_point {
+        .position = timing.position,
+        .hit_window_start = timing.position,
+        .hit_window_end = timing.position,
         .max_sqz_hit_window_start
         = {.beat = early_max_sqz_beat, .sp_measure = early_max_sqz_meas},
         .fill_start = {},
@@ -355,6 +367,7 @@ void append_note_points(std::vector<SightRead::Note>::const_iterator note,
         .is_hold_point = false,
         .is_sp_granting_note = is_note_sp_ender,
         .is_unison_sp_granting_note = is_unison_sp_ender};
+    set_hit_window(note_point, timing, time_map, pathing_settings.squeeze);
     *points++ = note_point;
 
     const auto [min_length, max_length] = minmax_lengths(*note);
@@ -372,6 +385,8 @@ void append_note_points(std::vector<SightRead::Note>::const_iterator note,
             }
         }
     }
+
+    return timing;
 }
 
 std::vector<Point>::iterator closest_point(std::vector<Point>& points,
@@ -512,9 +527,12 @@ bool is_note_skippable(const SightRead::Note& starting_note,
     return starting_note.position == note_to_test.position;
 }
 
+// Hold points are given a timing with their own position and no timing
+// window, so timings lines up with the returned points.
 std::vector<Point> unmultiplied_points(const SightRead::NoteTrack& track,
                                        const SpDurationData& duration_data,
-                                       const PathingSettings& pathing_settings)
+                                       const PathingSettings& pathing_settings,
+                                       std::vector<NoteTiming>& timings)
 {
     const auto& notes = track.notes();
     const auto& bres = track.bres();
@@ -557,18 +575,36 @@ std::vector<Point> unmultiplied_points(const SightRead::NoteTrack& track,
                                     current_phrase->length);
                 });
         }
-        append_note_points(p, notes, std::back_inserter(points),
-                           duration_data.time_map,
-                           track.global_data().resolution(), is_note_sp_ender,
-                           is_unison_sp_ender, pathing_settings);
+        const auto first_new_point = points.size();
+        timings.push_back(append_note_points(
+            p, notes, std::back_inserter(points), duration_data.time_map,
+            track.global_data().resolution(), is_note_sp_ender,
+            is_unison_sp_ender, pathing_settings));
+        for (auto i = first_new_point + 1; i < points.size(); ++i) {
+            timings.push_back({.position = points.at(i).position,
+                               .time = SightRead::Second {0.0},
+                               .early_window = SightRead::Second {0.0},
+                               .late_window = SightRead::Second {0.0}});
+        }
         p = q;
     }
 
-    std::ranges::stable_sort(points, [](const auto& x, const auto& y) {
-        return x.position.beat < y.position.beat;
+    std::vector<std::size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&](auto x, auto y) {
+        return points.at(x).position.beat < points.at(y).position.beat;
     });
+    std::vector<Point> sorted_points;
+    std::vector<NoteTiming> sorted_timings;
+    sorted_points.reserve(points.size());
+    sorted_timings.reserve(timings.size());
+    for (auto index : order) {
+        sorted_points.push_back(points.at(index));
+        sorted_timings.push_back(timings.at(index));
+    }
+    timings = std::move(sorted_timings);
 
-    return points;
+    return sorted_points;
 }
 
 std::string colours_string(const SightRead::Note& note)
@@ -690,9 +726,11 @@ std::vector<std::string> note_colours(const std::vector<SightRead::Note>& notes,
 
 std::vector<Point> points_from_track(const SightRead::NoteTrack& track,
                                      const SpDurationData& duration_data,
-                                     const PathingSettings& pathing_settings)
+                                     const PathingSettings& pathing_settings,
+                                     std::vector<NoteTiming>& timings)
 {
-    auto points = unmultiplied_points(track, duration_data, pathing_settings);
+    auto points = unmultiplied_points(track, duration_data, pathing_settings,
+                                      timings);
     if (track.track_type() == SightRead::TrackType::Drums) {
         add_drum_activation_points(track, points);
     }
@@ -714,6 +752,30 @@ std::vector<PointPtr> next_sp_note_vector(const std::vector<Point>& points)
         points, [](const auto& p) { return p.is_sp_granting_note; });
 }
 
+std::vector<PointPtr> next_fill_vector(const std::vector<Point>& points)
+{
+    return next_matching_vector(
+        points, [](const auto& p) { return p.fill_start.has_value(); });
+}
+
+// Sustain points' hit windows end at the points themselves, so the window
+// ends of the points are not in order. The running maximum of them is, which
+// is what first_window_end_after searches.
+std::vector<SpMeasure>
+latest_window_ends(const std::vector<Point>& points)
+{
+    std::vector<SpMeasure> measures;
+    measures.reserve(points.size());
+    for (const auto& p : points) {
+        auto latest_end = p.hit_window_end.sp_measure;
+        if (!measures.empty()) {
+            latest_end = std::max(latest_end, measures.back());
+        }
+        measures.push_back(latest_end);
+    }
+    return measures;
+}
+
 std::vector<int> score_totals(const std::vector<Point>& points)
 {
     std::vector<int> scores;
@@ -746,11 +808,14 @@ solo_boosts_from_solos(const std::vector<SightRead::Solo>& solos,
 PointSet::PointSet(const SightRead::NoteTrack& track,
                    const SpDurationData& duration_data,
                    const PathingSettings& pathing_settings)
-    : m_points {points_from_track(track, duration_data, pathing_settings)}
+    : m_points {points_from_track(track, duration_data, pathing_settings,
+                                  m_note_timings)}
     , m_first_after_current_sp {first_after_current_sp_vector(
           m_points, track, *pathing_settings.engine)}
     , m_next_non_hold_point {next_non_hold_vector(m_points)}
     , m_next_sp_granting_note {next_sp_note_vector(m_points)}
+    , m_next_fill_point {next_fill_vector(m_points)}
+    , m_latest_window_ends {latest_window_ends(m_points)}
     , m_solo_boosts {solo_boosts_from_solos(
           track.solos(pathing_settings.drum_settings), duration_data.time_map)}
     , m_cumulative_score_totals {score_totals(m_points)}
@@ -759,6 +824,64 @@ PointSet::PointSet(const SightRead::NoteTrack& track,
 {
 }
 
+PointSet::PointSet(const PointSet& other)
+    : m_note_timings {other.m_note_timings}
+    , m_points {other.m_points}
+    , m_first_after_current_sp {other.m_first_after_current_sp}
+    , m_next_non_hold_point {other.m_next_non_hold_point}
+    , m_next_sp_granting_note {other.m_next_sp_granting_note}
+    , m_next_fill_point {other.m_next_fill_point}
+    , m_latest_window_ends {other.m_latest_window_ends}
+    , m_solo_boosts {other.m_solo_boosts}
+    , m_cumulative_score_totals {other.m_cumulative_score_totals}
+    , m_video_lag {other.m_video_lag}
+    , m_colours {other.m_colours}
+{
+    const auto rebase = [&](auto& point_ptrs) {
+        for (auto& point : point_ptrs) {
+            point = std::next(cbegin(), std::distance(other.cbegin(), point));
+        }
+    };
+    rebase(m_first_after_current_sp);
+    rebase(m_next_non_hold_point);
+    rebase(m_next_sp_granting_note);
+    rebase(m_next_fill_point);
+}
+
+void PointSet::apply_timing_settings(const SightRead::NoteTrack& track,
+                                     const SpDurationData& duration_data,
+                                     const PathingSettings& pathing_settings)
+{
+    const auto& time_map = duration_data.time_map;
+    if (pathing_settings.engine->sustain_ticks_metric()
+        == SustainTicksMetric::Fretbar) {
+        // Sustain points take their timing windows from their note here, so
+        // they are simplest to make again. The number of points cannot
+        // change, so they are copied over the old ones to keep PointPtrs
+        // valid.
+        std::vector<NoteTiming> timings;
+        const auto points = points_from_track(track, duration_data,
+                                              pathing_settings, timings);
+        assert(points.size() == m_points.size());
+        std::ranges::copy(points, m_points.begin());
+    } else {
+        for (auto i = 0U; i < m_points.size(); ++i) {
+            auto& point = m_points.at(i);
+            if (!point.is_hold_point) {
+                set_hit_window(point, m_note_timings.at(i), time_map,
+                               pathing_settings.squeeze);
+            }
+        }
+        shift_points_by_video_lag(m_points, time_map,
+                                  pathing_settings.video_lag);
+    }
+    m_first_after_current_sp = first_after_current_sp_vector(
+        m_points, track, *pathing_settings.engine);
+    m_next_fill_point = next_fill_vector(m_points);
+    m_latest_window_ends = latest_window_ends(m_points);
+    m_video_lag = pathing_settings.video_lag;
+}
+
 PointPtr PointSet::first_after_current_phrase(PointPtr point) const
 {
     const auto index
@@ -780,6 +903,48 @@ PointPtr PointSet::next_sp_granting_note(PointPtr point) const
     return m_next_sp_granting_note.at(index);
 }
 
+PointPtr PointSet::next_fill_point(PointPtr point) const
+{
+    const auto index
+        = static_cast<std::size_t>(std::distance(m_points.data(), point));
+    return m_next_fill_point.at(index);
+}
+
+PointPtr PointSet::first_window_end_after(PointPtr start,
+                                          SpMeasure measure) const
+{
+    const auto start_index = std::distance(m_points.data(), start);
+    const auto* measures_begin = m_latest_window_ends.data();
+    const auto* low = std::next(measures_begin, start_index);
+    if (start_index > 0 && *std::prev(low) > measure) {
+        // A point before start has a window ending after measure, so the
+        // running maximum says nothing about the points from start on.
+        return std::find_if(start, cend(), [&](const auto& p) {
+            return p.hit_window_end.sp_measure > measure;
+        });
+    }
+
+    const auto ends_by_measure
+        = [&](SpMeasure window_end) { return window_end <= measure; };
+    const auto* end = std::next(
+        measures_begin,
+        static_cast<std::ptrdiff_t>(m_latest_window_ends.size()));
+    const auto* high = end;
+    std::ptrdiff_t step = 1;
+    while (step < std::distance(low, end)) {
+        const auto* probe = std::next(low, step);
+        if (!ends_by_measure(*probe)) {
+            high = probe;
+            break;
+        }
+        low = std::next(probe);
+        step *= 2;
+    }
+    const auto* first_after = std::partition_point(low, high, ends_by_measure);
+    return std::next(m_points.data(),
+                     std::distance(measures_begin, first_after));
+}
+
 int PointSet::range_score(PointPtr start, PointPtr end) const
 {
     const auto start_index
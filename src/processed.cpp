@@ -16,6 +16,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <iterator>
@@ -175,14 +176,51 @@ ProcessedSong::ProcessedSong(const SightRead::NoteTrack& track,
         solos.cbegin(), solos.cend(), 0,
         [](const auto x, const auto& y) { return x + y.value; });
 
+    set_phrase_note_spans(track);
+}
+
+ProcessedSong::ProcessedSong(const ProcessedSong& other)
+    : m_time_map {other.m_time_map}
+    , m_points {other.m_points}
+    , m_sp_data {other.m_sp_data}
+    , m_sp_engine_values {other.m_sp_engine_values}
+    , m_phrase_note_spans {other.m_phrase_note_spans}
+    , m_total_bre_boost {other.m_total_bre_boost}
+    , m_total_clean_play_boost {other.m_total_clean_play_boost}
+    , m_total_solo_boost {other.m_total_solo_boost}
+    , m_base_score {other.m_base_score}
+    , m_ignore_average_multiplier {other.m_ignore_average_multiplier}
+    , m_is_drums {other.m_is_drums}
+    , m_overlaps {other.m_overlaps}
+{
+    const auto rebase = [&](PointPtr point) {
+        return std::next(m_points.cbegin(),
+                         std::distance(other.m_points.cbegin(), point));
+    };
+    for (auto& span : m_phrase_note_spans) {
+        span = {.begin = rebase(span.begin), .end = rebase(span.end)};
+    }
+}
+
+void ProcessedSong::apply_timing_settings(
+    const SightRead::NoteTrack& track, const SpDurationData& duration_data,
+    const PathingSettings& pathing_settings)
+{
+    m_points.apply_timing_settings(track, duration_data, pathing_settings);
+    m_sp_data.apply_timing_settings(track, pathing_settings);
+    set_phrase_note_spans(track);
+}
+
+void ProcessedSong::set_phrase_note_spans(const SightRead::NoteTrack& track)
+{
+    m_phrase_note_spans.clear();
     m_phrase_note_spans.reserve(track.sp_phrases().size());
 
     const auto* first_phrase_point = m_points.cbegin();
     for (const auto& phrase : track.sp_phrases()) {
-        const auto phrase_start
-            = duration_data.time_map.to_beats(phrase.position);
+        const auto phrase_start = m_time_map.to_beats(phrase.position);
         const auto phrase_end
-            = duration_data.time_map.to_beats(phrase.position + phrase.length);
+            = m_time_map.to_beats(phrase.position + phrase.length);
         first_phrase_point = std::ranges::find_if(
             first_phrase_point, m_points.cend(), [&](const auto& pt) {
                 return !pt.is_hold_point && pt.position.beat >= phrase_start;
@@ -228,7 +266,7 @@ ProcessedSong::total_available_sp_with_earliest_pos(
     SightRead::Beat start, PointPtr first_point, PointPtr act_start,
     SpPosition earliest_potential_pos) const
 {
-    const SightRead::Beat BEAT_EPSILON {0.0001};
+    constexpr double BEAT_EPSILON = 0.0001;
 
     auto sp_bar = sp_from_phrases(first_point, act_start);
 
@@ -243,30 +281,26 @@ ProcessedSong::total_available_sp_with_earliest_pos(
 
     const auto extra_sp_required
         = m_sp_engine_values.minimum_to_activate - sp_bar.max();
-    auto first_beat = earliest_potential_pos.beat;
-    auto last_beat = act_start->position.beat;
-    if (m_sp_data.available_whammy(
-            first_beat, last_beat,
-            m_time_map.to_ticks(act_start->position.beat))
+    const auto act_start_tick = m_time_map.to_ticks(act_start->position.beat);
+    if (m_sp_data.available_whammy(earliest_potential_pos.beat,
+                                   act_start->position.beat, act_start_tick)
         < extra_sp_required) {
         return {sp_bar, earliest_potential_pos};
     }
 
-    while (last_beat - first_beat > BEAT_EPSILON) {
-        const auto mid_beat = (first_beat + last_beat) * 0.5;
-        if (m_sp_data.available_whammy(
-                earliest_potential_pos.beat, mid_beat,
-                m_time_map.to_ticks(act_start->position.beat))
-            < extra_sp_required) {
-            first_beat = mid_beat;
-        } else {
-            last_beat = mid_beat;
-        }
+    auto last_beat = m_sp_data.earliest_whammy_end(
+        earliest_potential_pos.beat, extra_sp_required, act_start_tick);
+    auto whammy = m_sp_data.available_whammy(earliest_potential_pos.beat,
+                                             last_beat, act_start_tick);
+    // Rounding can leave the whammy up to last_beat a fraction short.
+    if (whammy < extra_sp_required) {
+        last_beat = std::min(last_beat + SightRead::Beat {BEAT_EPSILON},
+                             act_start->position.beat);
+        whammy = m_sp_data.available_whammy(earliest_potential_pos.beat,
+                                            last_beat, act_start_tick);
     }
 
-    sp_bar.max() += m_sp_data.available_whammy(
-        earliest_potential_pos.beat, last_beat,
-        m_time_map.to_ticks(act_start->position.beat));
+    sp_bar.max() += whammy;
     sp_bar.max() = std::min(sp_bar.max(), 1.0);
 
     return {sp_bar,
@@ -593,17 +627,68 @@ ProcessedSong::drum_act_summaries(const Path& path) const
     return activation_summaries;
 }
 
-std::string ProcessedSong::path_summary(const Path& path) const
+RuntimeFeatures ProcessedSong::runtime_features() const
 {
-    constexpr double AVG_MULT_PRECISION = 1000.0;
+    RuntimeFeatures features {.point_count = 0,
+                              .phrase_count = 0,
+                              .whammy_coverage = 0.0,
+                              .sustain_density = 0.0};
+    if (m_points.cbegin() == m_points.cend()) {
+        return features;
+    }
+
+    const auto hold_count = std::count_if(
+        m_points.cbegin(), m_points.cend(),
+        [](const auto& point) { return point.is_hold_point; });
+    features.point_count = static_cast<std::size_t>(
+        std::distance(m_points.cbegin(), m_points.cend()));
+    features.phrase_count = static_cast<std::size_t>(std::count_if(
+        m_points.cbegin(), m_points.cend(),
+        [](const auto& point) { return point.is_sp_granting_note; }));
+    features.whammy_coverage = m_sp_data.whammy_coverage(
+        m_points.cbegin()->position.beat,
+        std::prev(m_points.cend())->position.beat);
+    features.sustain_density = static_cast<double>(hold_count)
+        / static_cast<double>(features.point_count);
+    return features;
+}
 
+std::string ProcessedSong::path_summary(const Path& path) const
+{
     // We use std::stringstream instead of std::string for better formatting
     // of floats (average multiplier and mid-sustain activation positions).
     std::stringstream stream;
-    stream << "Path: ";
-
     const auto activation_summaries
         = m_is_drums ? drum_act_summaries(path) : act_summaries(path);
+    append_score_summary(stream, path, activation_summaries);
+
+    if (!m_is_drums) {
+        stream << std::setprecision(2);
+        for (std::size_t i = 0; i < path.activations.size(); ++i) {
+            append_activation(stream, path.activations.at(i),
+                              activation_summaries.at(i));
+        }
+    }
+
+    return stream.str();
+}
+
+std::string ProcessedSong::score_summary(const Path& path) const
+{
+    std::stringstream stream;
+    append_score_summary(stream, path,
+                         m_is_drums ? drum_act_summaries(path)
+                                    : act_summaries(path));
+    return stream.str();
+}
+
+void ProcessedSong::append_score_summary(
+    std::stringstream& stream, const Path& path,
+    const std::vector<std::string>& activation_summaries) const
+{
+    constexpr double AVG_MULT_PRECISION = 1000.0;
+
+    stream << "Path: ";
     if (activation_summaries.empty()) {
         stream << "None";
     } else {
@@ -645,14 +730,4 @@ std::string ProcessedSong::path_summary(const Path& path) const
         stream << std::setprecision(3);
         stream << "\nAverage multiplier: " << avg_mult << 'x';
     }
-
-    if (!m_is_drums) {
-        stream << std::setprecision(2);
-        for (std::size_t i = 0; i < path.activations.size(); ++i) {
-            append_activation(stream, path.activations.at(i),
-                              activation_summaries.at(i));
-        }
-    }
-
-    return stream.str();
 }
@@ -16,6 +16,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <filesystem>
 #include <stdexcept>
 
 #include <QCommandLineParser>
@@ -121,6 +123,15 @@ std::unique_ptr<QCommandLineParser> arg_parser()
     parser->addVersionOption();
     parser->addOptions(
         {{{"f", "file"}, "Chart filename.", "file"},
+         {"setlist",
+          "Path every notes.chart and notes.mid in this folder and its "
+          "subfolders, saving each image next to its chart with the name of "
+          "--output. Replaces --file.",
+          "folder"},
+         {"jobs",
+          "Number of setlist songs to path at once. Default 1.",
+          "jobs",
+          "1"},
          {{"o", "output"},
           "Location to save output image (must be a .bmp or .png). Default "
           "path.png.",
@@ -143,6 +154,10 @@ std::unique_ptr<QCommandLineParser> arg_parser()
          {{"ew", "early-whammy"},
           "Early whammy% (0 to 100), <= squeeze, defaults to squeeze.",
           "early-whammy"},
+         {"squeeze-sweep",
+          "Comma separated squeeze% levels to find a path for in one run, "
+          "saving an image for each level. Replaces --squeeze.",
+          "squeeze-sweep"},
          {{"lazy", "lazy-whammy"},
           "Time before whammying starts on sustains in milliseconds. Default "
           "0.",
@@ -158,6 +173,55 @@ std::unique_ptr<QCommandLineParser> arg_parser()
           "video-lag",
           "0"},
          {{"s", "speed"}, "Speed in %. Default 100.", "speed", "100"},
+         {{"t", "threads"},
+          "Number of threads to use for optimisation. Default 1.",
+          "threads",
+          "1"},
+         {"branch-and-bound",
+          "Skip parts of the search that cannot beat the best path found so "
+          "far, and report how much was skipped. Single-threaded only."},
+         {"approximate",
+          "Skip parts of the search that could gain at most this many points, "
+          "and report how far below optimal the path may be. Single-threaded "
+          "only. Default 0.",
+          "approximate",
+          "0"},
+         {"low-memory",
+          "Use less memory by expanding notes twice and discarding unused "
+          "parts of the search. Single-threaded only."},
+         {"bottom-up",
+          "Build the search graph one note at a time from the end of the "
+          "song. Single-threaded only."},
+         {"merge-dominated",
+          "Skip activations that end at the same point as another activation "
+          "that is at least as good and leaves whammy available sooner."},
+         {"verify-dominated",
+          "Check --merge-dominated gives the same score as a full search."},
+         {"candidate-cache",
+          "Rough size in MiB of a cache of activation validity checks, 0 to "
+          "disable. Entry sizes are estimated, so this is not a memory "
+          "limit. Default 0.",
+          "candidate-cache",
+          "0"},
+         {"memory-report", "Report the peak memory used by CHOpt."},
+         {"stats",
+          "Report counts of the optimiser's work and how long it took as "
+          "JSON."},
+         {"progress", "Report how far the optimiser has got."},
+         {"time-limit",
+          "Stop optimising after this many seconds and use the best path "
+          "found so far.",
+          "time-limit"},
+         {"alternatives",
+          "Also list this many of the next best paths after the optimal one. "
+          "Default 0.",
+          "alternatives",
+          "0"},
+         {"alt-delta",
+          "Only list alternative paths at most this many points below the "
+          "optimal path. Default 500.",
+          "alt-delta",
+          "500"},
          {{"l", "lefty-flip"}, "Draw with lefty flip."},
          {"no-double-kick", "Disable 2x kick for drum charts."},
          {"no-kick", "Disable single kicks for drum charts."},
@@ -170,6 +234,9 @@ std::unique_ptr<QCommandLineParser> arg_parser()
          {{"p", "precision-mode"}, "Turn on precision mode for CH or YARG."},
          {{"b", "blank"}, "Give a blank chart image."},
          {"no-image", "Do not create an image."},
+         {"score-only",
+          "Only give the optimal score and the phrases used by each "
+          "activation. Implies --no-image."},
          {"no-bpms", "Do not draw BPMs."},
          {"no-solos", "Do not draw solo sections."},
          {"no-time-sigs", "Do not draw time signatures."},
@@ -243,6 +310,7 @@ Settings from_args(const QStringList& args, QTextStream& std_err)
     constexpr int MAX_VIDEO_LAG = 200;
     constexpr int MIN_SPEED = 5;
     constexpr double MS_PER_SECOND = 1000.0;
+    constexpr std::size_t BYTES_PER_MIB = 1024 * 1024;
     constexpr double SQUEEZE_EPSILON = 0.001;
 
     auto parser = arg_parser();
@@ -256,10 +324,21 @@ Settings from_args(const QStringList& args, QTextStream& std_err)
 
     settings.blank = parser->isSet("blank");
     settings.filename = parser->value("file").toStdString();
-    if (settings.filename.empty()) {
+    settings.setlist_path = parser->value("setlist").toStdString();
+    if (!settings.setlist_path.empty() && !settings.filename.empty()) {
+        throw std::invalid_argument("File and setlist cannot both be set");
+    }
+    if (settings.filename.empty() && settings.setlist_path.empty()) {
         throw std::invalid_argument("No file was specified");
     }
 
+    const auto jobs = parser->value("jobs").toInt();
+    if (jobs < 1) {
+        throw std::invalid_argument("Job count must be at least 1");
+    }
+
+    settings.setlist_jobs = static_cast<unsigned int>(jobs);
+
     const auto engine_name = parser->value("engine").toStdString();
     settings.game = game_from_string(engine_name);
 
@@ -278,7 +357,8 @@ Settings from_args(const QStringList& args, QTextStream& std_err)
     }
 
     settings.is_lefty_flip = parser->isSet("lefty-flip");
-    settings.draw_image = !parser->isSet("no-image");
+    settings.score_only = parser->isSet("score-only");
+    settings.draw_image = !parser->isSet("no-image") && !settings.score_only;
     settings.draw_bpms = !parser->isSet("no-bpms");
     settings.draw_solos = !parser->isSet("no-solos");
     settings.draw_time_sigs = !parser->isSet("no-time-sigs");
@@ -322,6 +402,50 @@ Settings from_args(const QStringList& args, QTextStream& std_err)
     settings.pathing_settings.squeeze
         = std::max(squeeze / 100.0, SQUEEZE_EPSILON);
     settings.pathing_settings.early_whammy = early_whammy / 100.0;
+
+    if (parser->isSet("squeeze-sweep")) {
+        if (parser->isSet("squeeze")) {
+            throw std::invalid_argument(
+                "Squeeze and squeeze sweep cannot both be set");
+        }
+        if (settings.blank || settings.score_only) {
+            throw std::invalid_argument(
+                "Squeeze sweep needs a path to be drawn");
+        }
+        if (!settings.setlist_path.empty()) {
+            throw std::invalid_argument(
+                "Squeeze sweep cannot be used with a setlist");
+        }
+        // Each level's image is saved with _sqz<percent> between the stem
+        // and extension of the output's file name, so it needs both.
+        const std::filesystem::path image_path {settings.image_path};
+        if (!image_path.has_stem() || !image_path.has_extension()) {
+            throw std::invalid_argument(
+                "Squeeze sweep output needs a file name and extension");
+        }
+        const auto levels = parser->value("squeeze-sweep").split(',');
+        for (const auto& level : levels) {
+            bool is_number = false;
+            const auto percent = level.trimmed().toInt(&is_number);
+            if (!is_number || percent < 0 || percent > MAX_PERCENT) {
+                throw std::invalid_argument(
+                    "Squeeze sweep levels must lie between 0 and 100");
+            }
+            const auto is_repeat = std::ranges::any_of(
+                settings.squeeze_sweep,
+                [&](const auto& x) { return x.percent == percent; });
+            if (is_repeat) {
+                throw std::invalid_argument(
+                    "Squeeze sweep levels must be distinct");
+            }
+            const auto level_early_whammy
+                = parser->isSet("early-whammy") ? early_whammy : percent;
+            settings.squeeze_sweep.push_back(
+                {.percent = percent,
+                 .squeeze = std::max(percent / 100.0, SQUEEZE_EPSILON),
+                 .early_whammy = level_early_whammy / 100.0});
+        }
+    }
     settings.pathing_settings.lazy_whammy
         = SightRead::Second {lazy_whammy / MS_PER_SECOND};
     settings.pathing_settings.whammy_delay
@@ -343,6 +467,127 @@ Settings from_args(const QStringList& args, QTextStream& std_err)
 
     settings.speed = speed;
 
+    const auto threads = parser->value("threads").toInt();
+    if (threads < 1) {
+        throw std::invalid_argument("Thread count must be at least 1");
+    }
+
+    settings.optimiser_settings.thread_count
+        = static_cast<unsigned int>(threads);
+    settings.optimiser_settings.branch_and_bound
+        = parser->isSet("branch-and-bound");
+    if (settings.optimiser_settings.branch_and_bound && threads > 1) {
+        throw std::invalid_argument(
+            "Branch and bound cannot be used with more than one thread");
+    }
+
+    const auto approximation_tolerance = parser->value("approximate").toInt();
+    if (approximation_tolerance < 0) {
+        throw std::invalid_argument(
+            "Approximation tolerance must be at least 0");
+    }
+
+    settings.optimiser_settings.approximation_tolerance
+        = approximation_tolerance;
+    if (approximation_tolerance > 0 && threads > 1) {
+        throw std::invalid_argument(
+            "Approximate search cannot be used with more than one thread");
+    }
+    settings.optimiser_settings.low_memory = parser->isSet("low-memory");
+    if (settings.optimiser_settings.low_memory && threads > 1) {
+        throw std::invalid_argument(
+            "Low memory mode cannot be used with more than one thread");
+    }
+    if (settings.optimiser_settings.low_memory
+        && settings.optimiser_settings.branch_and_bound) {
+        throw std::invalid_argument(
+            "Low memory mode cannot be used with branch and bound");
+    }
+    if (settings.optimiser_settings.low_memory
+        && approximation_tolerance > 0) {
+        throw std::invalid_argument(
+            "Low memory mode cannot be used with an approximate search");
+    }
+    settings.optimiser_settings.bottom_up = parser->isSet("bottom-up");
+    if (settings.optimiser_settings.bottom_up) {
+        if (threads > 1) {
+            throw std::invalid_argument(
+                "Bottom-up search cannot be used with more than one thread");
+        }
+        if (settings.optimiser_settings.branch_and_bound
+            || approximation_tolerance > 0) {
+            throw std::invalid_argument(
+                "Bottom-up search cannot be used with branch and bound");
+        }
+        if (settings.optimiser_settings.low_memory) {
+            throw std::invalid_argument(
+                "Bottom-up search cannot be used with low memory mode");
+        }
+    }
+    settings.optimiser_settings.merge_dominated_vertices
+        = parser->isSet("merge-dominated");
+    settings.optimiser_settings.verify_dominated_vertices
+        = parser->isSet("verify-dominated");
+
+    const auto candidate_cache = parser->value("candidate-cache").toInt();
+    if (candidate_cache < 0) {
+        throw std::invalid_argument("Candidate cache size must be at least 0");
+    }
+
+    settings.optimiser_settings.candidate_cache_bytes
+        = static_cast<std::size_t>(candidate_cache) * BYTES_PER_MIB;
+    settings.optimiser_settings.report_peak_memory
+        = parser->isSet("memory-report");
+    settings.optimiser_settings.report_stats = parser->isSet("stats");
+    settings.optimiser_settings.report_progress = parser->isSet("progress");
+
+    if (parser->isSet("time-limit")) {
+        const auto time_limit = parser->value("time-limit").toDouble();
+        if (time_limit <= 0.0) {
+            throw std::invalid_argument("Time limit must be positive");
+        }
+        if (!settings.setlist_path.empty()) {
+            throw std::invalid_argument(
+                "Time limit cannot be used with a setlist");
+        }
+        settings.optimiser_settings.time_limit
+            = std::chrono::milliseconds {
+                static_cast<std::chrono::milliseconds::rep>(time_limit
+                                                            * MS_PER_SECOND)};
+    }
+
+    const auto alternatives = parser->value("alternatives").toInt();
+    if (alternatives < 0) {
+        throw std::invalid_argument(
+            "Number of alternative paths must be at least 0");
+    }
+
+    settings.optimiser_settings.alternative_paths
+        = static_cast<std::size_t>(alternatives);
+
+    const auto alt_delta = parser->value("alt-delta").toInt();
+    if (alt_delta < 0) {
+        throw std::invalid_argument(
+            "Alternative path score delta must be at least 0");
+    }
+
+    settings.optimiser_settings.alternative_score_delta = alt_delta;
+
+    if (!settings.squeeze_sweep.empty() && alternatives > 0) {
+        throw std::invalid_argument(
+            "Alternative paths cannot be listed with a squeeze sweep");
+    }
+    if (settings.optimiser_settings.time_limit.has_value()
+        && alternatives > 0) {
+        throw std::invalid_argument(
+            "Alternative paths cannot be listed with a time limit");
+    }
+
+    if (approximation_tolerance > 0 && alternatives > 0) {
+        throw std::invalid_argument(
+            "Alternative paths cannot be listed with an approximate search");
+    }
+
     const auto opacity = parser->value("act-opacity").toFloat();
     if (opacity < 0.0F || opacity > 1.0F) {
         throw std::invalid_argument(
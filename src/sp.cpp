@@ -16,9 +16,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <iterator>
 #include <ranges>
+#include <vector>
 
 #include "sp.hpp"
 
@@ -104,13 +106,13 @@ public:
     }
 };
 
-std::vector<SpSustain> sp_whammy_spans(const SightRead::NoteTrack& track,
-                                       const PathingSettings& pathing_settings,
-                                       const SpTimeMap& time_map)
+std::vector<SpSustainTiming>
+sp_sustain_timings(const SightRead::NoteTrack& track, const Engine& engine,
+                   const SpTimeMap& time_map)
 {
     const auto& tempo_map = track.global_data().tempo_map();
     const ExtendedSustainGroups extended_sustains {track.notes()};
-    std::vector<SpSustain> spans;
+    std::vector<SpSustainTiming> timings;
     for (auto note = track.notes().cbegin(); note < track.notes().cend();
          ++note) {
         if (!is_note_part_of_phrase(track.sp_phrases(), *note)) {
@@ -137,39 +139,57 @@ std::vector<SpSustain> sp_whammy_spans(const SightRead::NoteTrack& track,
         }
         for (auto length : std::views::reverse(sustain_lengths)) {
             SightRead::Second early_timing_window {0};
-            if (pathing_settings.engine->has_early_whammy()) {
-                early_timing_window
-                    = SightRead::Second {pathing_settings.engine
-                                             ->early_timing_window(early_gap,
-                                                                   late_gap)}
-                    * pathing_settings.early_whammy;
+            if (engine.has_early_whammy()) {
+                early_timing_window = SightRead::Second {
+                    engine.early_timing_window(early_gap, late_gap)};
             }
 
-            const auto whammy_start_beat = tempo_map.to_beats(
-                tempo_map.to_seconds(note->position) - early_timing_window);
-            const SpPosition whammy_start {
-                .beat = whammy_start_beat,
-                .sp_measure = time_map.to_sp_measures(whammy_start_beat)};
             const auto whammy_end_beat
                 = tempo_map.to_beats(note->position + length);
             const SpPosition whammy_end {
                 .beat = whammy_end_beat,
                 .sp_measure = time_map.to_sp_measures(whammy_end_beat)};
-            auto burst_position = whammy_end;
-            if (pathing_settings.engine->has_whammy_bursts()) {
-                burst_position.beat
-                    -= SightRead::Beat {pathing_settings.engine->burst_size()};
-                burst_position.beat
-                    = std::max(burst_position.beat, whammy_start.beat);
-                burst_position.sp_measure
-                    = time_map.to_sp_measures(burst_position.beat);
-            }
+            timings.push_back(
+                {.note_position = note->position,
+                 .note_time = tempo_map.to_seconds(note->position),
+                 .early_timing_window = early_timing_window,
+                 .whammy_end = whammy_end,
+                 .releasable_for_burst = length == *sustain_lengths.rbegin()
+                     && extended_sustains.is_extended_sustain_ender(*note)});
+        }
+    }
 
-            spans.emplace_back(
-                note->position, whammy_start, whammy_end, burst_position,
-                length == *sustain_lengths.rbegin()
-                    && extended_sustains.is_extended_sustain_ender(*note));
+    return timings;
+}
+
+std::vector<SpSustain>
+sp_whammy_spans(const std::vector<SpSustainTiming>& timings,
+                const SightRead::TempoMap& tempo_map,
+                const PathingSettings& pathing_settings,
+                const SpTimeMap& time_map)
+{
+    std::vector<SpSustain> spans;
+    spans.reserve(timings.size());
+    for (const auto& timing : timings) {
+        const auto whammy_start_beat = tempo_map.to_beats(
+            timing.note_time
+            - timing.early_timing_window * pathing_settings.early_whammy);
+        const SpPosition whammy_start {
+            .beat = whammy_start_beat,
+            .sp_measure = time_map.to_sp_measures(whammy_start_beat)};
+        auto burst_position = timing.whammy_end;
+        if (pathing_settings.engine->has_whammy_bursts()) {
+            burst_position.beat
+                -= SightRead::Beat {pathing_settings.engine->burst_size()};
+            burst_position.beat
+                = std::max(burst_position.beat, whammy_start.beat);
+            burst_position.sp_measure
+                = time_map.to_sp_measures(burst_position.beat);
         }
+
+        spans.emplace_back(timing.note_position, whammy_start,
+                           timing.whammy_end, burst_position,
+                           timing.releasable_for_burst);
     }
 
     return spans;
@@ -224,10 +244,45 @@ SpData::SpData(const SightRead::NoteTrack& track,
     , m_beat_rates {form_beat_rates(track.global_data().tempo_map(),
                                     duration_data.od_beats,
                                     *pathing_settings.engine)}
+    , m_sustain_timings {sp_sustain_timings(track, *pathing_settings.engine,
+                                            m_time_map)}
     , m_sp_gain_rate {pathing_settings.engine->sp_gain_rate()}
     , m_default_net_sp_gain_rate {m_sp_gain_rate - 1 / DEFAULT_BEATS_PER_BAR}
 {
-    m_sp_sustains = sp_whammy_spans(track, pathing_settings, m_time_map);
+    set_sp_sustains(track.global_data().tempo_map(), pathing_settings);
+}
+
+SpData::SpData(const SpData& other)
+    : m_time_map {other.m_time_map}
+    , m_gain_mode {other.m_gain_mode}
+    , m_beat_rates {other.m_beat_rates}
+    , m_sustain_timings {other.m_sustain_timings}
+    , m_sp_sustains {other.m_sp_sustains}
+    , m_last_whammy_point {other.m_last_whammy_point}
+    , m_initial_guesses {other.m_initial_guesses}
+    , m_sp_gain_rate {other.m_sp_gain_rate}
+    , m_default_net_sp_gain_rate {other.m_default_net_sp_gain_rate}
+{
+    for (auto& guess : m_initial_guesses) {
+        guess = std::next(m_sp_sustains.cbegin(),
+                          std::distance(other.m_sp_sustains.cbegin(), guess));
+    }
+}
+
+void SpData::apply_timing_settings(const SightRead::NoteTrack& track,
+                                   const PathingSettings& pathing_settings)
+{
+    set_sp_sustains(track.global_data().tempo_map(), pathing_settings);
+}
+
+void SpData::set_sp_sustains(const SightRead::TempoMap& tempo_map,
+                             const PathingSettings& pathing_settings)
+{
+    m_sp_sustains = sp_whammy_spans(m_sustain_timings, tempo_map,
+                                    pathing_settings, m_time_map);
+    m_last_whammy_point
+        = SightRead::Beat {-std::numeric_limits<double>::infinity()};
+    m_initial_guesses.clear();
     for (auto& sustain : m_sp_sustains) {
         auto second_start = m_time_map.to_seconds(sustain.whammy_start.beat);
         second_start += pathing_settings.lazy_whammy;
@@ -485,6 +540,92 @@ double SpData::available_whammy(SightRead::Beat start, SightRead::Beat end,
     return total_whammy;
 }
 
+double SpData::whammy_coverage(SightRead::Beat start,
+                               SightRead::Beat end) const
+{
+    const auto full_whammy = sp_from_whammying_range(start, end);
+    if (full_whammy <= 0.0) {
+        return 0.0;
+    }
+    return available_whammy(start, end) / full_whammy;
+}
+
+// The inverse of sp_from_whammying_range for a fixed start.
+SightRead::Beat SpData::whammy_gain_end(SightRead::Beat start, double sp) const
+{
+    if (m_gain_mode == SpGainMode::Fretbar) {
+        return m_time_map.to_beats(m_time_map.to_fretbars(start)
+                                   + SightRead::Fretbar {sp / m_sp_gain_rate});
+    }
+    return start + SightRead::Beat {sp / m_sp_gain_rate};
+}
+
+SightRead::Beat SpData::earliest_whammy_end(SightRead::Beat start, double sp,
+                                            SightRead::Tick note_pos) const
+{
+    constexpr double POS_INF = std::numeric_limits<double>::infinity();
+
+    if (sp <= 0.0) {
+        return start;
+    }
+
+    // Sustains releasable for bursts can overlap, so this sweeps forward
+    // through the same whammy ranges as available_whammy, keeping the ends of
+    // the ranges that are being whammied. Between two range ends the whammy
+    // grows linearly, so the end is found exactly within that stretch.
+    std::vector<SightRead::Beat> active_range_ends;
+    auto position = start;
+    const auto sweep_to = [&](SightRead::Beat end) {
+        while (!active_range_ends.empty() && position < end) {
+            const auto stretch_end
+                = std::min(end, std::ranges::min(active_range_ends));
+            const auto range_count
+                = static_cast<double>(active_range_ends.size());
+            const auto gain
+                = range_count * sp_from_whammying_range(position, stretch_end);
+            if (gain >= sp) {
+                position = std::min(
+                    whammy_gain_end(position, sp / range_count), stretch_end);
+                return true;
+            }
+            sp -= gain;
+            position = stretch_end;
+            std::erase_if(active_range_ends,
+                          [&](const auto& range_end) {
+                              return range_end <= position;
+                          });
+        }
+        position = std::max(position, end);
+        return false;
+    };
+
+    SightRead::Beat last_burst_position {-POS_INF};
+    for (auto p = first_sp_sustain_after(start);
+         p < m_sp_sustains.cend() && p->note_position < note_pos; ++p) {
+        if (p->burst_position.beat <= last_burst_position) {
+            continue;
+        }
+        const auto whammy_start = std::max(p->whammy_start.beat, start);
+        if (sweep_to(whammy_start)) {
+            return position;
+        }
+        if (whammy_start < p->whammy_end.beat) {
+            active_range_ends.push_back(p->whammy_end.beat);
+        }
+        if (p->releasable_for_burst) {
+            start = std::max(start, p->burst_position.beat);
+        } else {
+            start = std::max(start, p->whammy_end.beat);
+        }
+        last_burst_position = p->burst_position.beat;
+    }
+
+    if (sweep_to(SightRead::Beat {POS_INF})) {
+        return position;
+    }
+    return SightRead::Beat {POS_INF};
+}
+
 SpPosition SpData::sp_drain_end_point(SpPosition start,
                                       double sp_bar_amount) const
 {
@@ -19,6 +19,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "activationendset.hpp"
+#include "arena.hpp"
 
 using IntSet = ActivationEndSet<int>;
 
@@ -208,3 +209,71 @@ BOOST_AUTO_TEST_CASE(next_absent_element_respects_temporary_elements)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(set_spanning_several_words)
+
+BOOST_AUTO_TEST_CASE(next_absent_element_skips_runs_of_present_elements)
+{
+    IntSet set {0, 300};
+    for (auto i = 10; i < 150; ++i) {
+        set.add(i);
+    }
+    for (auto i = 150; i < 250; ++i) {
+        set.add_temporary_element(i);
+    }
+
+    BOOST_CHECK_EQUAL(set.lowest_absent_element(), 0);
+    BOOST_CHECK_EQUAL(set.next_absent_element(9), 250);
+}
+
+BOOST_AUTO_TEST_CASE(add_advances_past_every_permanent_element)
+{
+    IntSet set {0, 300};
+    for (auto i = 1; i < 200; ++i) {
+        set.add(i);
+    }
+    set.add(0);
+
+    BOOST_CHECK(set.contains(199));
+    BOOST_CHECK_EQUAL(set.lowest_absent_element(), 200);
+}
+
+BOOST_AUTO_TEST_CASE(next_absent_element_returns_end_when_all_are_present)
+{
+    IntSet set {0, 130};
+    for (auto i = 1; i < 130; ++i) {
+        set.add_temporary_element(i);
+    }
+
+    BOOST_CHECK_EQUAL(set.next_absent_element(0), 130);
+}
+
+BOOST_AUTO_TEST_CASE(clear_temporary_elements_clears_every_word)
+{
+    IntSet set {0, 300};
+    set.add_temporary_element(5);
+    set.add_temporary_element(290);
+    set.clear_temporary_elements();
+
+    BOOST_CHECK(!set.contains(5));
+    BOOST_CHECK(!set.contains(290));
+    BOOST_CHECK_EQUAL(set.next_absent_element(4), 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(set_with_memory_resource)
+
+BOOST_AUTO_TEST_CASE(elements_are_allocated_from_the_resource)
+{
+    Arena arena;
+    IntSet set {0, 10, &arena};
+    set.add(5);
+    set.add_temporary_element(7);
+
+    BOOST_CHECK(set.contains(5));
+    BOOST_CHECK_EQUAL(set.next_absent_element(4), 6);
+    BOOST_CHECK_GT(arena.allocation_count(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "arena.hpp"
+
+BOOST_AUTO_TEST_SUITE(arena)
+
+BOOST_AUTO_TEST_CASE(allocations_are_aligned)
+{
+    Arena arena;
+
+    BOOST_CHECK(arena.allocate(1, 1) != nullptr);
+    auto* ptr = arena.allocate(8, 64);
+
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(ptr) % 64, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(allocations_do_not_overlap)
+{
+    Arena arena {64};
+
+    auto* first = static_cast<std::byte*>(arena.allocate(48, 8));
+    auto* second = static_cast<std::byte*>(arena.allocate(48, 8));
+
+    BOOST_CHECK(first + 48 <= second || second + 48 <= first);
+    BOOST_CHECK_EQUAL(arena.block_count(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(large_allocations_get_their_own_block)
+{
+    Arena arena {64};
+
+    BOOST_CHECK(arena.allocate(1000, 8) != nullptr);
+
+    BOOST_CHECK_EQUAL(arena.block_count(), 1U);
+    BOOST_CHECK_EQUAL(arena.allocation_count(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(reset_reuses_blocks)
+{
+    Arena arena {256};
+    std::vector<void*> first_pointers;
+    std::vector<void*> second_pointers;
+
+    for (auto i = 0; i < 10; ++i) {
+        first_pointers.push_back(arena.allocate(64, 8));
+    }
+    const auto block_count = arena.block_count();
+    arena.reset();
+    for (auto i = 0; i < 10; ++i) {
+        second_pointers.push_back(arena.allocate(64, 8));
+    }
+
+    BOOST_CHECK_EQUAL(arena.block_count(), block_count);
+    BOOST_CHECK_EQUAL(arena.allocation_count(), 20U);
+    BOOST_CHECK_EQUAL_COLLECTIONS(first_pointers.cbegin(),
+                                  first_pointers.cend(),
+                                  second_pointers.cbegin(),
+                                  second_pointers.cend());
+}
+
+BOOST_AUTO_TEST_CASE(pool_reuses_arenas_once_leases_end)
+{
+    ArenaPool pool;
+
+    {
+        const auto first_lease = pool.lease();
+        const auto second_lease = pool.lease();
+        BOOST_CHECK(&first_lease.arena() != &second_lease.arena());
+        BOOST_CHECK(first_lease.arena().allocate(8, 8) != nullptr);
+    }
+    const auto lease = pool.lease();
+
+    BOOST_CHECK_EQUAL(pool.arena_count(), 2U);
+    BOOST_CHECK_EQUAL(pool.allocation_count(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1932,3 +1932,21 @@ BOOST_AUTO_TEST_CASE(nearly_overlapped_phrases_are_handled_correctly)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE(runtime_features_are_found_from_notes)
+{
+    SightRead::NoteTrack track {
+        {make_note(0), make_note(192, 192), make_note(768)},
+        SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(
+        {{.position = SightRead::Tick {0}, .length = SightRead::Tick {1}},
+         {.position = SightRead::Tick {192}, .length = SightRead::Tick {1}}});
+
+    const auto features = runtime_features(track);
+
+    BOOST_CHECK_EQUAL(features.point_count, 3U);
+    BOOST_CHECK_EQUAL(features.phrase_count, 2U);
+    BOOST_CHECK_CLOSE(features.sustain_density, 1.0 / 3, 0.0001);
+    BOOST_CHECK_CLOSE(features.whammy_coverage, 0.25, 0.0001);
+}
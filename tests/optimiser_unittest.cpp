@@ -961,3 +961,717 @@ BOOST_AUTO_TEST_CASE(one_phrase_acts_use_ew_when_bigger_than_squeeze)
 
     BOOST_CHECK_EQUAL(opt_path.score_boost, 50);
 }
+
+BOOST_AUTO_TEST_CASE(parallel_graph_construction_gives_the_same_path)
+{
+    std::vector<SightRead::Note> notes {
+        make_note(0),    make_note(192),   make_note(384),  make_note(3224),
+        make_note(9378), make_note(15714), make_note(15715)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {3224}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {9378}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser serial_optimiser {&track, &term_bool, 100,
+                                SightRead::Second(0.0)};
+    Optimiser parallel_optimiser {&track, &term_bool, 100,
+                                  SightRead::Second(0.0), {.thread_count = 4}};
+
+    const auto serial_path = serial_optimiser.optimal_path();
+    const auto parallel_path = parallel_optimiser.optimal_path();
+
+    BOOST_CHECK_EQUAL(serial_path.score_boost, parallel_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        serial_path.activations.cbegin(), serial_path.activations.cend(),
+        parallel_path.activations.cbegin(), parallel_path.activations.cend());
+}
+
+BOOST_AUTO_TEST_CASE(parallel_graph_construction_handles_many_full_sp_segments)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP));
+        if (i % 3 != 2) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser serial_optimiser {&track, &term_bool, 100,
+                                SightRead::Second(0.0)};
+    Optimiser parallel_optimiser {&track, &term_bool, 100,
+                                  SightRead::Second(0.0), {.thread_count = 4}};
+
+    const auto serial_path = serial_optimiser.optimal_path();
+    const auto parallel_path = parallel_optimiser.optimal_path();
+
+    BOOST_CHECK_EQUAL(serial_path.score_boost, parallel_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        serial_path.activations.cbegin(), serial_path.activations.cend(),
+        parallel_path.activations.cbegin(), parallel_path.activations.cend());
+    // The activations are reconstructed on several threads, so check they
+    // were put back in order with identical whammy ends.
+    BOOST_REQUIRE_GT(parallel_path.activations.size(), 1U);
+    for (auto i = 0U; i < serial_path.activations.size(); ++i) {
+        BOOST_CHECK_EQUAL(serial_path.activations[i].whammy_end.value(),
+                          parallel_path.activations[i].whammy_end.value());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(branch_and_bound_gives_the_same_path)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP + (i % 4) * 96));
+        if (i % 3 == 0) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    Optimiser bounded_optimiser {&track, &term_bool, 100,
+                                 SightRead::Second(0.0),
+                                 {.branch_and_bound = true}};
+
+    const auto path = optimiser.optimal_path();
+    GraphSearchStats stats;
+    const auto bounded_path = bounded_optimiser.optimal_path(&stats);
+
+    BOOST_CHECK_EQUAL(path.score_boost, bounded_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        path.activations.cbegin(), path.activations.cend(),
+        bounded_path.activations.cbegin(), bounded_path.activations.cend());
+    BOOST_CHECK_GT(stats.expanded_vertices, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(bottom_up_graph_construction_gives_the_same_path)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP + (i % 4) * 96));
+        if (i % 3 == 0) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    Optimiser bottom_up_optimiser {&track, &term_bool, 100,
+                                   SightRead::Second(0.0), {.bottom_up = true}};
+
+    const auto path = optimiser.optimal_path();
+    const auto bottom_up_path = bottom_up_optimiser.optimal_path();
+
+    BOOST_CHECK_EQUAL(path.score_boost, bottom_up_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        path.activations.cbegin(), path.activations.cend(),
+        bottom_up_path.activations.cbegin(), bottom_up_path.activations.cend());
+}
+
+BOOST_AUTO_TEST_CASE(low_memory_graph_construction_gives_the_same_path)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP + (i % 4) * 96));
+        if (i % 3 == 0) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    Optimiser low_memory_optimiser {&track, &term_bool, 100,
+                                    SightRead::Second(0.0),
+                                    {.low_memory = true}};
+
+    const auto path = optimiser.optimal_path();
+    const auto low_memory_path = low_memory_optimiser.optimal_path();
+
+    BOOST_CHECK_EQUAL(path.score_boost, low_memory_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(path.activations.cbegin(),
+                                  path.activations.cend(),
+                                  low_memory_path.activations.cbegin(),
+                                  low_memory_path.activations.cend());
+}
+
+// Drum activations can only start at fill ends, so the activation from 1728
+// can end on the note at 4736, which the one from 1536 cannot reach. Both lead
+// to the phrase at 6000 with the same score, but the later activation ends
+// later, so its edge is dominated.
+BOOST_AUTO_TEST_CASE(merging_dominated_vertices_gives_the_same_score)
+{
+    std::vector<SightRead::Note> notes {
+        make_drum_note(0),    make_drum_note(192),  make_drum_note(1536),
+        make_drum_note(1728), make_drum_note(4500), make_drum_note(4736),
+        make_drum_note(6000)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {1}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {1}},
+        {.position = SightRead::Tick {6000}, .length = SightRead::Tick {1}}};
+    std::vector<SightRead::DrumFill> fills {
+        {.position = SightRead::Tick {1440}, .length = SightRead::Tick {96}},
+        {.position = SightRead::Tick {1632}, .length = SightRead::Tick {96}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::Drums,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    note_track.drum_fills(fills);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_drums_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    Optimiser merging_optimiser {&track, &term_bool, 100,
+                                 SightRead::Second(0.0),
+                                 {.merge_dominated_vertices = true}};
+    Optimiser verifying_optimiser {&track, &term_bool, 100,
+                                   SightRead::Second(0.0),
+                                   {.verify_dominated_vertices = true}};
+
+    const auto path = optimiser.optimal_path();
+    GraphSearchStats stats;
+    const auto merged_path = merging_optimiser.optimal_path(&stats);
+
+    BOOST_CHECK_GT(stats.dominated_edges, 0U);
+    BOOST_CHECK_EQUAL(merged_path.score_boost, path.score_boost);
+    BOOST_CHECK_EQUAL(verifying_optimiser.optimal_path().score_boost,
+                      path.score_boost);
+}
+
+BOOST_AUTO_TEST_CASE(approximate_search_is_within_its_reported_loss)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+    constexpr int TOLERANCE = 100;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP + (i % 4) * 96));
+        if (i % 3 == 0) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser exact_optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    Optimiser approximate_optimiser {&track, &term_bool, 100,
+                                     SightRead::Second(0.0),
+                                     {.approximation_tolerance = TOLERANCE}};
+
+    const auto exact_path = exact_optimiser.optimal_path();
+    GraphSearchStats stats;
+    const auto path = approximate_optimiser.optimal_path(&stats);
+
+    BOOST_CHECK_LE(path.score_boost, exact_path.score_boost);
+    BOOST_CHECK_GE(path.score_boost,
+                   exact_path.score_boost - stats.max_score_loss);
+    BOOST_CHECK_LE(stats.max_score_loss, TOLERANCE);
+}
+
+BOOST_AUTO_TEST_CASE(candidate_cache_gives_the_same_path)
+{
+    constexpr int NOTE_COUNT = 24;
+    constexpr int NOTE_GAP = 768;
+
+    std::vector<SightRead::Note> notes;
+    std::vector<SightRead::StarPower> phrases;
+    for (int i = 0; i < NOTE_COUNT; ++i) {
+        notes.push_back(make_note(i * NOTE_GAP + (i % 4) * 96));
+        if (i % 3 == 0) {
+            phrases.push_back({.position = SightRead::Tick {i * NOTE_GAP},
+                               .length = SightRead::Tick {50}});
+        }
+    }
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser uncached_optimiser {&track, &term_bool, 100,
+                                  SightRead::Second(0.0)};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0),
+                         {.candidate_cache_bytes = std::size_t {1} << 20U}};
+
+    const auto uncached_path = uncached_optimiser.optimal_path();
+    GraphSearchStats stats;
+    const auto path = optimiser.optimal_path(&stats);
+
+    BOOST_CHECK_EQUAL(path.score_boost, uncached_path.score_boost);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        path.activations.cbegin(), path.activations.cend(),
+        uncached_path.activations.cbegin(), uncached_path.activations.cend());
+    BOOST_CHECK_GT(stats.candidate_cache_hits, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(search_stats_count_the_work_done)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0),
+                         {.candidate_cache_bytes = 0}};
+
+    GraphSearchStats stats;
+    const auto path = optimiser.optimal_path(&stats);
+
+    BOOST_CHECK_EQUAL(path.activations.size(), 1U);
+    BOOST_CHECK_GT(stats.graph_vertices, 1U);
+    BOOST_CHECK_GE(stats.generated_edges, stats.graph_vertices - 1);
+    BOOST_CHECK_GT(stats.successful_candidates, 0U);
+    BOOST_CHECK_EQUAL(stats.candidate_cache_hits, 0U);
+    BOOST_CHECK_GE(stats.graph_time.count(), 0.0);
+    BOOST_CHECK_GE(stats.path_time.count(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(anytime_path_is_optimal_if_not_terminated)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+
+    const auto result = optimiser.anytime_path();
+
+    BOOST_CHECK(result.is_optimal);
+    BOOST_CHECK_EQUAL(result.path.score_boost,
+                      optimiser.optimal_path().score_boost);
+}
+
+BOOST_AUTO_TEST_CASE(anytime_path_returns_a_path_if_terminated)
+{
+    const std::atomic<bool> terminated {true};
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &terminated, 100, SightRead::Second(0.0)};
+    Optimiser unterminated_optimiser {&track, &term_bool, 100,
+                                      SightRead::Second(0.0)};
+
+    const auto result = optimiser.anytime_path();
+
+    BOOST_CHECK(!result.is_optimal);
+    BOOST_CHECK_LE(result.path.score_boost,
+                   unterminated_optimiser.optimal_path().score_boost);
+    BOOST_CHECK_THROW([&] { return optimiser.optimal_path(); }(),
+                      OptimisationCancelled);
+}
+
+BOOST_AUTO_TEST_CASE(anytime_path_keeps_the_best_path_found_before_termination)
+{
+    std::atomic<bool> terminated {false};
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &terminated, 100, SightRead::Second(0.0)};
+    Optimiser unterminated_optimiser {&track, &term_bool, 100,
+                                      SightRead::Second(0.0)};
+    // Progress is only reported by the full search, so this stops it part
+    // way through after the quick path has been found.
+    optimiser.set_progress_callback(
+        [&](int /*percent*/) { terminated = true; });
+
+    const auto result = optimiser.anytime_path();
+
+    BOOST_CHECK(!result.is_optimal);
+    BOOST_CHECK_EQUAL(result.path.activations.size(), 1U);
+    BOOST_CHECK_LE(result.path.score_boost,
+                   unterminated_optimiser.optimal_path().score_boost);
+}
+
+BOOST_AUTO_TEST_CASE(optimal_score_matches_optimal_path)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+
+    const auto path = optimiser.optimal_path();
+    const auto score_path = optimiser.optimal_score();
+
+    BOOST_CHECK_EQUAL(score_path.score_boost, path.score_boost);
+    BOOST_REQUIRE_EQUAL(score_path.activations.size(), path.activations.size());
+    for (auto i = 0U; i < path.activations.size(); ++i) {
+        BOOST_CHECK(score_path.activations[i].act_start
+                    == path.activations[i].act_start);
+        BOOST_CHECK(score_path.activations[i].act_end
+                    == path.activations[i].act_end);
+    }
+    BOOST_CHECK_EQUAL(track.score_summary(score_path),
+                      track.score_summary(path));
+}
+
+BOOST_AUTO_TEST_CASE(best_paths_are_distinct_and_in_order)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    constexpr int SCORE_DELTA = 1000;
+
+    const auto path = optimiser.optimal_path();
+    const auto paths = optimiser.best_paths(4, SCORE_DELTA);
+
+    BOOST_REQUIRE_GT(paths.size(), 1U);
+    BOOST_CHECK_LE(paths.size(), 4U);
+    BOOST_CHECK_EQUAL(track.path_summary(paths.front()),
+                      track.path_summary(path));
+    for (auto i = 1U; i < paths.size(); ++i) {
+        BOOST_CHECK_LE(paths[i].score_boost, paths[i - 1].score_boost);
+        BOOST_CHECK_GE(paths[i].score_boost, path.score_boost - SCORE_DELTA);
+        for (auto j = 0U; j < i; ++j) {
+            BOOST_CHECK_NE(track.score_summary(paths[i]),
+                           track.score_summary(paths[j]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(best_paths_with_no_delta_only_gives_optimal_paths)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+
+    const auto path = optimiser.optimal_path();
+    const auto paths = optimiser.best_paths(4, 0);
+
+    BOOST_REQUIRE(!paths.empty());
+    for (const auto& best_path : paths) {
+        BOOST_CHECK_EQUAL(best_path.score_boost, path.score_boost);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(optimiser_gives_the_same_path_after_new_timing_settings)
+{
+    std::vector<SightRead::Note> notes {make_note(0, 96), make_note(192),
+                                        make_note(384, 384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {384}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    auto new_settings = default_guitar_pathing_settings();
+    new_settings.squeeze = 0.5;
+    new_settings.early_whammy = 0.25;
+    new_settings.video_lag = SightRead::Second {0.05};
+    new_settings.whammy_delay = SightRead::Second {0.1};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const ProcessedSong expected_track {note_track, default_measure_mode_data(),
+                                        new_settings};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    const Optimiser expected_optimiser {&expected_track, &term_bool, 100,
+                                        new_settings.whammy_delay};
+
+    (void)optimiser.optimal_path();
+    track.apply_timing_settings(note_track, default_measure_mode_data(),
+                                new_settings);
+    optimiser.apply_timing_settings(new_settings.whammy_delay);
+    const auto path = optimiser.optimal_path();
+    const auto expected_path = expected_optimiser.optimal_path();
+
+    BOOST_CHECK_EQUAL(path.score_boost, expected_path.score_boost);
+    BOOST_CHECK_EQUAL(track.path_summary(path),
+                      expected_track.path_summary(expected_path));
+}
+
+BOOST_AUTO_TEST_CASE(every_search_stops_when_terminated)
+{
+    const std::atomic<bool> terminated {true};
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    OptimiserSettings bounded_settings;
+    bounded_settings.branch_and_bound = true;
+    OptimiserSettings parallel_settings;
+    parallel_settings.thread_count = 4;
+    Optimiser bounded_optimiser {&track, &terminated, 100,
+                                 SightRead::Second(0.0), bounded_settings};
+    Optimiser parallel_optimiser {&track, &terminated, 100,
+                                  SightRead::Second(0.0), parallel_settings};
+
+    BOOST_CHECK_THROW([&] { return bounded_optimiser.optimal_path(); }(),
+                      OptimisationCancelled);
+    BOOST_CHECK_THROW([&] { return parallel_optimiser.optimal_path(); }(),
+                      OptimisationCancelled);
+}
+
+BOOST_AUTO_TEST_CASE(progress_is_reported_in_increasing_order_up_to_100)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(3840),
+                                        make_note(4032), make_note(7680)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    Optimiser optimiser {&track, &term_bool, 100, SightRead::Second(0.0)};
+    std::vector<int> percentages;
+    optimiser.set_progress_callback(
+        [&](int percent) { percentages.push_back(percent); });
+
+    const auto path = optimiser.optimal_path();
+
+    BOOST_REQUIRE(!percentages.empty());
+    BOOST_CHECK(std::ranges::is_sorted(percentages));
+    BOOST_CHECK(std::ranges::adjacent_find(percentages) == percentages.end());
+    BOOST_CHECK_EQUAL(percentages.back(), 100);
+}
+
+BOOST_AUTO_TEST_SUITE(candidate_cache)
+
+BOOST_AUTO_TEST_CASE(stored_results_are_found)
+{
+    SightRead::NoteTrack note_track {
+        {make_note(0), make_note(192)}, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const ActivationCandidate candidate {
+        .act_start = track.points().cbegin(),
+        .act_end = std::next(track.points().cbegin()),
+        .earliest_activation_point = {.beat = SightRead::Beat {0.0},
+                                      .sp_measure = SpMeasure {0.0}},
+        .sp_bar = {0.5, 0.5, track.sp_engine_values()}};
+    auto negative_zero_candidate = candidate;
+    negative_zero_candidate.earliest_activation_point
+        = {.beat = SightRead::Beat {-0.0}, .sp_measure = SpMeasure {-0.0}};
+    const ActResult result {.ending_position
+                            = {.beat = SightRead::Beat {1.0},
+                               .sp_measure = SpMeasure {0.25}},
+                            .validity = ActValidity::success};
+    CandidateCache cache {std::size_t {1} << 20U};
+
+    BOOST_CHECK(!cache.find(CandidateKey::make(candidate)).has_value());
+    cache.store(CandidateKey::make(candidate), result);
+    const auto cached_result
+        = cache.find(CandidateKey::make(negative_zero_candidate));
+
+    BOOST_REQUIRE(cached_result.has_value());
+    BOOST_CHECK_EQUAL(cached_result->ending_position.beat.value(), 1.0);
+    BOOST_CHECK_EQUAL(cache.hits(), 1U);
+    BOOST_CHECK_EQUAL(cache.misses(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(keys_only_match_within_the_tolerance)
+{
+    SightRead::NoteTrack note_track {
+        {make_note(0), make_note(192)}, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const ActivationCandidate candidate {
+        .act_start = track.points().cbegin(),
+        .act_end = std::next(track.points().cbegin()),
+        .earliest_activation_point = {.beat = SightRead::Beat {0.1},
+                                      .sp_measure = SpMeasure {0.025}},
+        .sp_bar = {0.3, 0.7, track.sp_engine_values()}};
+    auto noisy_candidate = candidate;
+    noisy_candidate.earliest_activation_point.beat
+        += SightRead::Beat {CandidateKey::TOLERANCE / 100};
+    noisy_candidate.sp_bar.max() -= CandidateKey::TOLERANCE / 100;
+    auto distinct_candidate = candidate;
+    distinct_candidate.earliest_activation_point.beat
+        += SightRead::Beat {CandidateKey::TOLERANCE * 10};
+
+    BOOST_CHECK(CandidateKey::make(candidate)
+                == CandidateKey::make(noisy_candidate));
+    BOOST_CHECK(!(CandidateKey::make(candidate)
+                  == CandidateKey::make(distinct_candidate)));
+}
+
+BOOST_AUTO_TEST_CASE(cache_does_not_grow_past_its_budget)
+{
+    SightRead::NoteTrack note_track {
+        {make_note(0), make_note(192)}, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    constexpr std::size_t BUDGET = 64 * CandidateCache::ENTRY_BYTES;
+    CandidateCache cache {BUDGET};
+
+    for (auto i = 0; i < 1000; ++i) {
+        const ActivationCandidate candidate {
+            .act_start = track.points().cbegin(),
+            .act_end = std::next(track.points().cbegin()),
+            .earliest_activation_point
+            = {.beat = SightRead::Beat {i * 1.0},
+               .sp_measure = SpMeasure {i * 0.25}},
+            .sp_bar = {0.5, 0.5, track.sp_engine_values()}};
+        cache.store(CandidateKey::make(candidate),
+                    {.ending_position = candidate.earliest_activation_point,
+                     .validity = ActValidity::success});
+    }
+
+    BOOST_CHECK_LE(cache.size() * CandidateCache::ENTRY_BYTES, BUDGET);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(packed_vertex_keys)
+
+BOOST_AUTO_TEST_CASE(negative_zero_and_zero_positions_have_the_same_key)
+{
+    SightRead::NoteTrack note_track {
+        {make_note(0), make_note(192)}, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const PathGraphVertex first {.point = track.points().cbegin(),
+                                 .position = {.beat = SightRead::Beat {0.0},
+                                              .sp_measure = SpMeasure {0.0}}};
+    const PathGraphVertex second {.point = track.points().cbegin(),
+                                  .position = {.beat = SightRead::Beat {-0.0},
+                                               .sp_measure = SpMeasure {-0.0}}};
+
+    BOOST_CHECK(VertexKey<PathGraphVertex>::make(first)
+                == VertexKey<PathGraphVertex>::make(second));
+}
+
+BOOST_AUTO_TEST_CASE(keys_distinguish_points_and_max_sp_vertices)
+{
+    SightRead::NoteTrack note_track {
+        {make_note(0), make_note(192)}, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const PathGraphVertex vertex {.point = track.points().cbegin()};
+    auto next_point_vertex = vertex;
+    next_point_vertex.point = std::next(track.points().cbegin());
+    auto max_sp_vertex = vertex;
+    max_sp_vertex.is_max_sp_vertex = true;
+
+    const auto key = VertexKey<PathGraphVertex>::make(vertex);
+
+    BOOST_CHECK(key != VertexKey<PathGraphVertex>::make(next_point_vertex));
+    BOOST_CHECK(key != VertexKey<PathGraphVertex>::make(max_sp_vertex));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -16,11 +16,15 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
 #include <ostream>
+#include <stdexcept>
 #include <tuple>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
+#include "arena.hpp"
 #include "pathgraph.hpp"
 
 using TestGraph = PathGraph<int, int>;
@@ -75,7 +79,7 @@ BOOST_AUTO_TEST_CASE(adds_edge_to_out_edges)
     const std::vector<TestGraph::Edge> expected_edges {
         {.dest_vertex_id = 1, .weight = -1, .property = 5}};
 
-    BOOST_CHECK_EQUAL_COLLECTIONS(out_edges.cbegin(), out_edges.cend(),
+    BOOST_CHECK_EQUAL_COLLECTIONS(out_edges.begin(), out_edges.end(),
                                   expected_edges.cbegin(),
                                   expected_edges.cend());
 }
@@ -137,11 +141,114 @@ BOOST_AUTO_TEST_CASE(prunes_suboptimal_edges_if_destinations_have_been_pruned)
     const std::vector<TestGraph::Edge> expected_out_edges {
         {.dest_vertex_id = 2, .weight = 100, .property = 0}};
 
-    BOOST_CHECK_EQUAL_COLLECTIONS(out_edges.cbegin(), out_edges.cend(),
+    BOOST_CHECK_EQUAL_COLLECTIONS(out_edges.begin(), out_edges.end(),
                                   expected_out_edges.cbegin(),
                                   expected_out_edges.cend());
 }
 
+BOOST_AUTO_TEST_CASE(pruning_keeps_vector_properties_of_optimal_edges)
+{
+    PathGraph<int, std::vector<int>> graph {100};
+
+    graph.insert_vertex(200);
+    graph.insert_vertex(300);
+    graph.add_edge(0, 1, 50, {1, 2});
+    graph.add_edge(1, 2, 10, {3});
+    graph.add_edge(0, 2, 100, {4, 5, 6});
+
+    for (int i = 2; i >= 0; --i) {
+        graph.prune_suboptimal_out_edges(i);
+    }
+
+    const auto out_edges = graph.out_edges(0);
+    BOOST_REQUIRE_EQUAL(out_edges.size(), 1U);
+    const auto property = graph.edge_property(out_edges.front());
+    const std::vector<int> expected_property {4, 5, 6};
+
+    BOOST_CHECK_EQUAL(out_edges.front().dest_vertex_id, 2U);
+    BOOST_CHECK_EQUAL_COLLECTIONS(property.begin(), property.end(),
+                                  expected_property.cbegin(),
+                                  expected_property.cend());
+}
+
+BOOST_AUTO_TEST_CASE(pruning_with_slack_keeps_near_optimal_edges_best_first)
+{
+    TestGraph graph {100, 20};
+
+    for (auto i = 1; i <= 4; ++i) {
+        graph.insert_vertex(100 + i);
+    }
+    graph.add_edge(0, 1, 85, 0);
+    graph.add_edge(0, 2, 70, 0);
+    graph.add_edge(0, 3, 100, 0);
+    graph.add_edge(0, 4, 90, 0);
+
+    for (int i = 4; i >= 0; --i) {
+        graph.prune_suboptimal_out_edges(i);
+    }
+
+    const auto& out_edges = graph.out_edges(0);
+    const std::vector<TestGraph::Edge> expected_out_edges {
+        {.dest_vertex_id = 3, .weight = 100, .property = 0},
+        {.dest_vertex_id = 4, .weight = 90, .property = 0},
+        {.dest_vertex_id = 1, .weight = 85, .property = 0}};
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(out_edges.begin(), out_edges.end(),
+                                  expected_out_edges.cbegin(),
+                                  expected_out_edges.cend());
+    BOOST_CHECK_EQUAL(*graph.optimal_subpath_value(0), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(discard_unreferenced_vertices)
+
+BOOST_AUTO_TEST_CASE(removes_vertices_only_unreferenced_vertices_lead_to)
+{
+    PathGraph<int, std::vector<int>> graph {100};
+
+    graph.insert_vertex(200);
+    graph.insert_vertex(300);
+    graph.insert_vertex(400);
+    graph.add_edge(2, 3, 10, std::vector<int> {4});
+    for (int i = 3; i >= 1; --i) {
+        graph.prune_suboptimal_out_edges(i);
+    }
+    graph.add_edge(0, 1, 5, std::vector<int> {2});
+    graph.prune_suboptimal_out_edges(0);
+
+    const auto new_ids
+        = graph.discard_unreferenced_vertices([](int /*vertex*/) {
+              return true;
+          });
+
+    const std::vector<std::size_t> expected_new_ids {
+        0, 1, decltype(graph)::REMOVED_VERTEX, decltype(graph)::REMOVED_VERTEX};
+    BOOST_CHECK_EQUAL_COLLECTIONS(new_ids.cbegin(), new_ids.cend(),
+                                  expected_new_ids.cbegin(),
+                                  expected_new_ids.cend());
+    BOOST_CHECK_EQUAL(graph.vertex_count(), 2U);
+    BOOST_CHECK(!graph.find_vertex(300).has_value());
+    BOOST_REQUIRE_EQUAL(graph.out_edges(0).size(), 1U);
+    const auto& edge = graph.out_edges(0).front();
+    BOOST_CHECK_EQUAL(graph.vertex_property(edge.dest_vertex_id), 200);
+    BOOST_CHECK_EQUAL(graph.edge_property(edge).front(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_vertices_that_are_not_closed)
+{
+    TestGraph graph {100};
+
+    graph.insert_vertex(200);
+    graph.prune_suboptimal_out_edges(1);
+
+    const auto new_ids = graph.discard_unreferenced_vertices(
+        [](int vertex) { return vertex != 200; });
+
+    BOOST_CHECK_EQUAL(new_ids.at(1), 1U);
+    BOOST_CHECK_EQUAL(graph.vertex_count(), 2U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(out_edge_aggregate)
@@ -165,14 +272,50 @@ BOOST_AUTO_TEST_CASE(add_activation_doesnt_add_multiple_edges_to_same_vertex)
     BOOST_CHECK_EQUAL(std::distance(aggregate.begin(), aggregate.end()), 1);
 }
 
+BOOST_AUTO_TEST_CASE(edges_are_allocated_from_the_resource)
+{
+    Arena arena;
+    TestAggregate aggregate {&arena};
+
+    aggregate.add_activation(0, 1, 0);
+    aggregate.add_activation(0, 2, 0);
+
+    BOOST_CHECK_GT(arena.allocation_count(), 0U);
+    BOOST_CHECK_EQUAL(aggregate.begin()->activations.size(), 2U);
+    BOOST_CHECK(aggregate.begin()->activations.get_allocator().resource()
+                == &arena);
+}
+
+BOOST_AUTO_TEST_CASE(remove_dominated_edges_keeps_undominated_edges_in_order)
+{
+    TestAggregate aggregate;
+
+    aggregate.add_activation(12, {}, 5);
+    aggregate.add_activation(11, {}, 5);
+    aggregate.add_activation(21, {}, 1);
+    aggregate.add_activation(13, {}, 7);
+
+    const auto removed_count = aggregate.remove_dominated_edges(
+        [](int v) { return v / 10; }, [](int v) { return v % 10; });
+    std::vector<int> dest_vertices;
+    for (const auto& edge : aggregate) {
+        dest_vertices.push_back(edge.dest_vertex);
+    }
+    std::vector<int> expected_dest_vertices {11, 21, 13};
+
+    BOOST_CHECK_EQUAL(removed_count, 1U);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        dest_vertices.cbegin(), dest_vertices.cend(),
+        expected_dest_vertices.cbegin(), expected_dest_vertices.cend());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(generate_optimal_graph_tests)
 
 BOOST_AUTO_TEST_CASE(returns_graph_with_no_edges_if_out_edges_empty)
 {
-    const auto no_edges = [](const auto& graph, const auto& vertex) {
-        (void)graph;
+    const auto no_edges = [](const auto& vertex) {
         (void)vertex;
         return std::vector<TestAggregate::Edge> {};
     };
@@ -184,4 +327,391 @@ BOOST_AUTO_TEST_CASE(returns_graph_with_no_edges_if_out_edges_empty)
     BOOST_CHECK(graph.out_edges(0).empty());
 }
 
+BOOST_AUTO_TEST_CASE(parallel_generation_gives_same_graph_as_serial)
+{
+    const auto divisor_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        for (auto i = vertex + 1; i <= 60; ++i) {
+            if (i % vertex == 0) {
+                edges.push_back(
+                    {.dest_vertex = i, .weight = i % 7, .activations = {i}});
+            }
+        }
+        return edges;
+    };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>,
+                                 decltype(divisor_edges)>(1, divisor_edges);
+    const auto parallel_graph
+        = generate_optimal_graph_parallel<int, std::vector<int>,
+                                          decltype(divisor_edges)>(
+            1, divisor_edges, 4);
+
+    for (std::size_t id = 0; id < 60; ++id) {
+        BOOST_CHECK_EQUAL(serial_graph.vertex_property(id),
+                          parallel_graph.vertex_property(id));
+        const auto& serial_edges = serial_graph.out_edges(id);
+        const auto& parallel_edges = parallel_graph.out_edges(id);
+        BOOST_REQUIRE_EQUAL(serial_edges.size(), parallel_edges.size());
+        for (auto j = 0U; j < serial_edges.size(); ++j) {
+            BOOST_CHECK_EQUAL(serial_edges[j].dest_vertex_id,
+                              parallel_edges[j].dest_vertex_id);
+            BOOST_CHECK_EQUAL(serial_edges[j].weight,
+                              parallel_edges[j].weight);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_table_only_gives_up_stored_values)
+{
+    ConcurrentVertexTable<int, int> table;
+
+    BOOST_CHECK(table.try_claim(1));
+    BOOST_CHECK(!table.try_claim(1));
+    BOOST_CHECK_THROW(table.take(1), std::logic_error);
+    BOOST_CHECK_THROW(table.take(2), std::logic_error);
+    table.store(1, 5);
+    BOOST_CHECK_EQUAL(table.take(1), 5);
+    BOOST_CHECK_THROW(table.take(1), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_generation_gives_same_optimal_path_as_serial)
+{
+    const auto step_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        if (vertex + 1 <= 20) {
+            edges.push_back(
+                {.dest_vertex = vertex + 1, .weight = 1, .activations = {1}});
+        }
+        if (vertex + 2 <= 20) {
+            edges.push_back(
+                {.dest_vertex = vertex + 2, .weight = 4, .activations = {2}});
+        }
+        return edges;
+    };
+    const auto upper_bound = [](int vertex) { return 2 * (20 - vertex); };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>, decltype(step_edges)>(
+            0, step_edges);
+    GraphSearchStats stats;
+    const auto bounded_graph
+        = generate_optimal_graph_bounded<int, std::vector<int>,
+                                         decltype(step_edges),
+                                         decltype(upper_bound)>(
+            0, step_edges, upper_bound, stats);
+
+    auto serial_id = serial_graph.root_vertex_id();
+    auto bounded_id = bounded_graph.root_vertex_id();
+    while (!serial_graph.out_edges(serial_id).empty()) {
+        BOOST_REQUIRE(!bounded_graph.out_edges(bounded_id).empty());
+        const auto& serial_edge = serial_graph.out_edges(serial_id).front();
+        const auto& bounded_edge = bounded_graph.out_edges(bounded_id).front();
+        BOOST_CHECK_EQUAL(serial_edge.weight, bounded_edge.weight);
+        serial_id = serial_edge.dest_vertex_id;
+        bounded_id = bounded_edge.dest_vertex_id;
+        BOOST_CHECK_EQUAL(serial_graph.vertex_property(serial_id),
+                          bounded_graph.vertex_property(bounded_id));
+    }
+    BOOST_CHECK(bounded_graph.out_edges(bounded_id).empty());
+    BOOST_CHECK_GT(stats.pruned_vertices, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(approximate_bounded_generation_reports_its_score_loss)
+{
+    const auto step_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        for (auto step = 1; step <= 3 && vertex + step <= 20; ++step) {
+            edges.push_back({.dest_vertex = vertex + step,
+                             .weight = step * step + vertex % 3,
+                             .activations = {step}});
+        }
+        return edges;
+    };
+    const auto upper_bound = [](int vertex) { return 5 * (20 - vertex); };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>, decltype(step_edges)>(
+            0, step_edges);
+    const auto optimal_value
+        = *serial_graph.optimal_subpath_value(serial_graph.root_vertex_id());
+
+    for (const auto tolerance : {0, 2, 5, 1000}) {
+        GraphSearchStats stats;
+        const auto graph
+            = generate_optimal_graph_bounded<int, std::vector<int>,
+                                             decltype(step_edges),
+                                             decltype(upper_bound)>(
+                0, step_edges, upper_bound, stats, nullptr, 0, tolerance);
+        const auto value = *graph.optimal_subpath_value(graph.root_vertex_id());
+
+        BOOST_CHECK_LE(value, optimal_value);
+        BOOST_CHECK_GE(value, optimal_value - stats.max_score_loss);
+        BOOST_CHECK_GE(stats.max_score_loss, 0);
+        BOOST_CHECK_LE(stats.max_score_loss, tolerance);
+        if (tolerance == 0) {
+            BOOST_CHECK_EQUAL(value, optimal_value);
+        } else if (tolerance == 1000) {
+            BOOST_CHECK_GT(stats.max_score_loss, 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(approximate_bounded_generation_rejects_edge_slack)
+{
+    const auto no_edges = [](int /*vertex*/) {
+        return std::vector<TestAggregate::Edge> {};
+    };
+    const auto upper_bound = [](int /*vertex*/) { return 0; };
+    GraphSearchStats stats;
+
+    BOOST_CHECK_THROW(
+        (generate_optimal_graph_bounded<int, std::vector<int>,
+                                        decltype(no_edges),
+                                        decltype(upper_bound)>(
+            0, no_edges, upper_bound, stats, nullptr, 1, 1)),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_generation_can_stop_with_the_best_path_so_far)
+{
+    std::atomic<bool> terminate {false};
+    int expanded_vertices = 0;
+    const auto step_edges = [&](int vertex) {
+        ++expanded_vertices;
+        if (expanded_vertices == 8) {
+            terminate = true;
+        }
+        std::vector<TestAggregate::Edge> edges;
+        for (auto step = 1; step <= 3 && vertex + step <= 20; ++step) {
+            edges.push_back({.dest_vertex = vertex + step,
+                             .weight = step * step,
+                             .activations = {step}});
+        }
+        return edges;
+    };
+    const auto upper_bound = [](int vertex) { return 3 * (20 - vertex); };
+    const auto generate = [&](bool* is_complete) {
+        GraphSearchStats stats;
+        return generate_optimal_graph_bounded<int, std::vector<int>,
+                                              decltype(step_edges),
+                                              decltype(upper_bound)>(
+            0, step_edges, upper_bound, stats, &terminate, 0, 0, is_complete);
+    };
+
+    auto is_complete = true;
+    const auto graph = generate(&is_complete);
+
+    BOOST_CHECK(!is_complete);
+    BOOST_CHECK_EQUAL(expanded_vertices, 8);
+    auto vertex_id = graph.root_vertex_id();
+    const auto value = *graph.optimal_subpath_value(vertex_id);
+    BOOST_CHECK_GT(value, 0);
+    auto path_weight = 0;
+    while (!graph.out_edges(vertex_id).empty()) {
+        const auto& edge = graph.out_edges(vertex_id).front();
+        path_weight += edge.weight;
+        vertex_id = edge.dest_vertex_id;
+    }
+    BOOST_CHECK_EQUAL(path_weight, value);
+
+    expanded_vertices = 0;
+    BOOST_CHECK_THROW(generate(nullptr), OptimisationCancelled);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_generation_with_slack_keeps_same_edges_as_serial)
+{
+    const auto step_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        for (auto step = 1; step <= 3 && vertex + step <= 20; ++step) {
+            edges.push_back({.dest_vertex = vertex + step,
+                             .weight = step * step,
+                             .activations = {step}});
+        }
+        return edges;
+    };
+    const auto upper_bound = [](int vertex) { return 3 * (20 - vertex); };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>, decltype(step_edges)>(
+            0, step_edges, nullptr, 2);
+    GraphSearchStats stats;
+    const auto bounded_graph
+        = generate_optimal_graph_bounded<int, std::vector<int>,
+                                         decltype(step_edges),
+                                         decltype(upper_bound)>(
+            0, step_edges, upper_bound, stats, nullptr, 2);
+
+    for (auto vertex = 0; vertex <= 20; ++vertex) {
+        const auto serial_id = serial_graph.find_vertex(vertex);
+        const auto bounded_id = bounded_graph.find_vertex(vertex);
+        if (!bounded_id.has_value()) {
+            continue;
+        }
+        BOOST_REQUIRE(serial_id.has_value());
+        const auto& serial_edges = serial_graph.out_edges(*serial_id);
+        const auto& bounded_edges = bounded_graph.out_edges(*bounded_id);
+        BOOST_REQUIRE_EQUAL(serial_edges.size(), bounded_edges.size());
+        for (auto j = 0U; j < serial_edges.size(); ++j) {
+            BOOST_CHECK_EQUAL(
+                serial_graph.vertex_property(serial_edges[j].dest_vertex_id),
+                bounded_graph.vertex_property(
+                    bounded_edges[j].dest_vertex_id));
+            BOOST_CHECK_EQUAL(serial_edges[j].weight, bounded_edges[j].weight);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bottom_up_generation_keeps_same_edges_as_serial)
+{
+    const auto divisor_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        for (auto i = vertex + 1; i <= 60; ++i) {
+            if (i % vertex == 0) {
+                edges.push_back(
+                    {.dest_vertex = i, .weight = i % 7, .activations = {i}});
+            }
+        }
+        return edges;
+    };
+    const auto point_index
+        = [](int vertex) { return static_cast<std::size_t>(vertex); };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>,
+                                 decltype(divisor_edges)>(1, divisor_edges);
+    const auto bottom_up_graph
+        = generate_optimal_graph_bottom_up<int, std::vector<int>,
+                                           decltype(divisor_edges),
+                                           decltype(point_index)>(
+            1, divisor_edges, point_index);
+
+    BOOST_CHECK_EQUAL(bottom_up_graph.vertex_count(),
+                      serial_graph.vertex_count());
+    BOOST_CHECK_EQUAL(bottom_up_graph.vertex_property(
+                          bottom_up_graph.root_vertex_id()),
+                      1);
+    for (auto vertex = 1; vertex <= 60; ++vertex) {
+        const auto serial_id = serial_graph.find_vertex(vertex);
+        const auto bottom_up_id = bottom_up_graph.find_vertex(vertex);
+        BOOST_REQUIRE(serial_id.has_value());
+        BOOST_REQUIRE(bottom_up_id.has_value());
+        BOOST_CHECK_EQUAL(
+            *serial_graph.optimal_subpath_value(*serial_id),
+            *bottom_up_graph.optimal_subpath_value(*bottom_up_id));
+        const auto& serial_edges = serial_graph.out_edges(*serial_id);
+        const auto& bottom_up_edges = bottom_up_graph.out_edges(*bottom_up_id);
+        BOOST_REQUIRE_EQUAL(serial_edges.size(), bottom_up_edges.size());
+        for (auto j = 0U; j < serial_edges.size(); ++j) {
+            BOOST_CHECK_EQUAL(
+                serial_graph.vertex_property(serial_edges[j].dest_vertex_id),
+                bottom_up_graph.vertex_property(
+                    bottom_up_edges[j].dest_vertex_id));
+            BOOST_CHECK_EQUAL(serial_edges[j].weight,
+                              bottom_up_edges[j].weight);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bottom_up_generation_fails_if_an_edge_goes_backwards)
+{
+    const auto cycle_edges = [](int vertex) {
+        return std::vector<TestAggregate::Edge> {
+            {.dest_vertex = (vertex + 1) % 3, .weight = 1, .activations = {1}}};
+    };
+    const auto point_index
+        = [](int vertex) { return static_cast<std::size_t>(vertex); };
+    const auto generate = [&] {
+        return generate_optimal_graph_bottom_up<int, std::vector<int>,
+                                                decltype(cycle_edges),
+                                                decltype(point_index)>(
+            0, cycle_edges, point_index);
+    };
+
+    BOOST_CHECK_THROW(generate(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(low_memory_generation_gives_same_optimal_path_as_serial)
+{
+    const auto divisor_edges = [](int vertex) {
+        std::vector<TestAggregate::Edge> edges;
+        for (auto i = vertex + 1; i <= 60; ++i) {
+            if (i % vertex == 0) {
+                edges.push_back(
+                    {.dest_vertex = i, .weight = i % 7, .activations = {i}});
+            }
+        }
+        return edges;
+    };
+    const auto point_index
+        = [](int vertex) { return static_cast<std::size_t>(vertex); };
+
+    const auto serial_graph
+        = generate_optimal_graph<int, std::vector<int>,
+                                 decltype(divisor_edges)>(1, divisor_edges);
+    const auto low_memory_graph
+        = generate_optimal_graph_low_memory<int, std::vector<int>,
+                                            decltype(divisor_edges),
+                                            decltype(point_index)>(
+            1, divisor_edges, point_index);
+
+    BOOST_CHECK_LT(low_memory_graph.vertex_count(),
+                   serial_graph.vertex_count());
+    auto serial_id = serial_graph.root_vertex_id();
+    auto low_memory_id = low_memory_graph.root_vertex_id();
+    BOOST_CHECK_EQUAL(*low_memory_graph.optimal_subpath_value(low_memory_id),
+                      *serial_graph.optimal_subpath_value(serial_id));
+    while (!serial_graph.out_edges(serial_id).empty()) {
+        BOOST_REQUIRE(!low_memory_graph.out_edges(low_memory_id).empty());
+        serial_id = serial_graph.out_edges(serial_id).front().dest_vertex_id;
+        low_memory_id
+            = low_memory_graph.out_edges(low_memory_id).front().dest_vertex_id;
+        BOOST_CHECK_EQUAL(low_memory_graph.vertex_property(low_memory_id),
+                          serial_graph.vertex_property(serial_id));
+    }
+    BOOST_CHECK(low_memory_graph.out_edges(low_memory_id).empty());
+}
+
+BOOST_AUTO_TEST_CASE(low_memory_generation_fails_if_an_edge_goes_backwards)
+{
+    const auto cycle_edges = [](int vertex) {
+        return std::vector<TestAggregate::Edge> {
+            {.dest_vertex = (vertex + 1) % 3, .weight = 1, .activations = {1}}};
+    };
+    const auto point_index
+        = [](int vertex) { return static_cast<std::size_t>(vertex); };
+    const auto generate = [&] {
+        return generate_optimal_graph_low_memory<int, std::vector<int>,
+                                                 decltype(cycle_edges),
+                                                 decltype(point_index)>(
+            0, cycle_edges, point_index);
+    };
+
+    BOOST_CHECK_THROW(generate(), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(generation_stops_once_terminate_is_set)
+{
+    std::atomic<bool> terminate {false};
+    int expanded_vertices = 0;
+    const auto step_edges = [&](int vertex) {
+        ++expanded_vertices;
+        if (vertex == 5) {
+            terminate = true;
+        }
+        return std::vector<TestAggregate::Edge> {
+            {.dest_vertex = vertex + 1, .weight = 1, .activations = {1}}};
+    };
+
+    const auto generate = [&] {
+        return generate_optimal_graph<int, std::vector<int>,
+                                      decltype(step_edges)>(0, step_edges,
+                                                            &terminate);
+    };
+
+    BOOST_CHECK_THROW(generate(), OptimisationCancelled);
+    BOOST_CHECK_EQUAL(expanded_vertices, 6);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
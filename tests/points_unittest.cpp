@@ -918,6 +918,62 @@ BOOST_AUTO_TEST_CASE(next_sp_granting_note_is_correct)
         std::prev(points.cend()));
 }
 
+BOOST_AUTO_TEST_CASE(first_window_end_after_is_correct)
+{
+    std::vector<SightRead::Note> notes;
+    for (auto i = 0; i < 8; ++i) {
+        notes.push_back(make_note(192 * i));
+    }
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_unique<SightRead::SongGlobalData>()};
+
+    PointSet points {track, default_measure_mode_data(),
+                     default_guitar_pathing_settings()};
+    const auto fourth_point = std::next(points.cbegin(), 3);
+    const auto fourth_end = fourth_point->hit_window_end.sp_measure;
+
+    BOOST_CHECK_EQUAL(
+        points.first_window_end_after(points.cbegin(), fourth_end),
+        std::next(fourth_point));
+    const auto seventh_point = std::next(points.cbegin(), 6);
+    BOOST_CHECK_EQUAL(points.first_window_end_after(seventh_point, fourth_end),
+                      seventh_point);
+    BOOST_CHECK_EQUAL(
+        points.first_window_end_after(points.cbegin(), SpMeasure {-1.0}),
+        points.cbegin());
+    BOOST_CHECK_EQUAL(
+        points.first_window_end_after(points.cbegin(), SpMeasure {100.0}),
+        points.cend());
+}
+
+// The first ticks of a sustain have windows ending at their own position,
+// before the late window of the sustained note ends.
+BOOST_AUTO_TEST_CASE(first_window_end_after_handles_sustain_points)
+{
+    SightRead::NoteTrack track {{make_note(0, 192), make_note(384)},
+                                SightRead::TrackType::FiveFret,
+                                std::make_unique<SightRead::SongGlobalData>()};
+
+    PointSet points {track, default_measure_mode_data(),
+                     default_guitar_pathing_settings()};
+    const auto first_tick = std::next(points.cbegin());
+    BOOST_REQUIRE(first_tick->is_hold_point);
+    BOOST_REQUIRE(first_tick->hit_window_end.sp_measure
+                  < points.cbegin()->hit_window_end.sp_measure);
+
+    for (auto start = points.cbegin(); start < points.cend(); ++start) {
+        for (auto p = points.cbegin(); p < points.cend(); ++p) {
+            const auto measure = p->hit_window_end.sp_measure;
+            const auto expected
+                = std::find_if(start, points.cend(), [&](const auto& q) {
+                      return q.hit_window_end.sp_measure > measure;
+                  });
+            BOOST_CHECK_EQUAL(points.first_window_end_after(start, measure),
+                              expected);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(solo_sections_are_added)
 {
     std::vector<SightRead::Solo> solos {{.start = SightRead::Tick {0},
@@ -1101,6 +1157,25 @@ BOOST_AUTO_TEST_CASE(activation_notes_are_marked_with_drum_fills)
     BOOST_TEST(!(begin + 3)->fill_start.has_value());
 }
 
+BOOST_AUTO_TEST_CASE(next_fill_point_is_correct)
+{
+    std::vector<SightRead::Note> notes {make_drum_note(0), make_drum_note(192),
+                                        make_drum_note(385),
+                                        make_drum_note(576)};
+    std::vector<SightRead::DrumFill> fills {
+        {.position = SightRead::Tick {384}, .length = SightRead::Tick {5}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::Drums,
+                                std::make_unique<SightRead::SongGlobalData>()};
+    track.drum_fills(fills);
+    PointSet points {track, default_measure_mode_data(),
+                     default_drums_pathing_settings()};
+    const auto* begin = points.cbegin();
+
+    BOOST_CHECK_EQUAL(points.next_fill_point(begin), begin + 2);
+    BOOST_CHECK_EQUAL(points.next_fill_point(begin + 2), begin + 2);
+    BOOST_CHECK_EQUAL(points.next_fill_point(begin + 3), points.cend());
+}
+
 BOOST_AUTO_TEST_CASE(fills_ending_only_in_a_kick_are_not_killed)
 {
     std::vector<SightRead::Note> notes {
@@ -1643,6 +1643,116 @@ BOOST_AUTO_TEST_CASE(effect_on_notes_is_taken_account_of)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_CASE(applying_timing_settings_matches_a_new_song)
+{
+    std::vector<SightRead::Note> notes {make_note(192), make_note(384, 192),
+                                        make_note(768, 384), make_note(1536)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {384}, .length = SightRead::Tick {1}},
+        {.position = SightRead::Tick {768}, .length = SightRead::Tick {1}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    auto new_settings = no_squeeze_positive_video_lag_settings();
+    new_settings.squeeze = 0.5;
+    new_settings.early_whammy = 0.5;
+    new_settings.lazy_whammy = SightRead::Second {0.05};
+    ProcessedSong song {track, default_measure_mode_data(),
+                        default_guitar_pathing_settings()};
+    const ProcessedSong expected_song {track, default_measure_mode_data(),
+                                       new_settings};
+    const auto* first_point = song.points().cbegin();
+
+    song.apply_timing_settings(track, default_measure_mode_data(),
+                               new_settings);
+    const auto& points = song.points();
+    const auto& expected_points = expected_song.points();
+
+    BOOST_CHECK(points.cbegin() == first_point);
+    BOOST_REQUIRE_EQUAL(std::distance(points.cbegin(), points.cend()),
+                        std::distance(expected_points.cbegin(),
+                                      expected_points.cend()));
+    for (auto i = 0; i < std::distance(points.cbegin(), points.cend()); ++i) {
+        const auto& point = points.cbegin()[i];
+        const auto& expected_point = expected_points.cbegin()[i];
+        BOOST_CHECK_EQUAL(point.position.beat.value(),
+                          expected_point.position.beat.value());
+        BOOST_CHECK_EQUAL(point.hit_window_start.beat.value(),
+                          expected_point.hit_window_start.beat.value());
+        BOOST_CHECK_EQUAL(point.hit_window_end.beat.value(),
+                          expected_point.hit_window_end.beat.value());
+    }
+    const auto sp = song.total_available_sp(
+        SightRead::Beat(0.0), points.cbegin(), std::prev(points.cend()));
+    const auto expected_sp = expected_song.total_available_sp(
+        SightRead::Beat(0.0), expected_points.cbegin(),
+        std::prev(expected_points.cend()));
+    BOOST_CHECK_EQUAL(sp.min(), expected_sp.min());
+    BOOST_CHECK_EQUAL(sp.max(), expected_sp.max());
+}
+
+BOOST_AUTO_TEST_CASE(copied_songs_refer_to_their_own_points)
+{
+    std::vector<SightRead::Note> notes {make_note(192), make_note(384, 192),
+                                        make_note(768, 384), make_note(1536)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {384}, .length = SightRead::Tick {1}},
+        {.position = SightRead::Tick {768}, .length = SightRead::Tick {1}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    const ProcessedSong song {track, default_measure_mode_data(),
+                              default_guitar_pathing_settings()};
+    const auto& song_points = song.points();
+
+    const ProcessedSong copy {song};
+    const auto& points = copy.points();
+
+    BOOST_CHECK(points.cbegin() != song_points.cbegin());
+    BOOST_CHECK_EQUAL(
+        std::distance(points.cbegin(),
+                      points.next_sp_granting_note(points.cbegin())),
+        std::distance(song_points.cbegin(),
+                      song_points.next_sp_granting_note(song_points.cbegin())));
+    const auto sp = copy.total_available_sp(
+        SightRead::Beat(0.0), points.cbegin(), std::prev(points.cend()));
+    const auto expected_sp = song.total_available_sp(
+        SightRead::Beat(0.0), song_points.cbegin(),
+        std::prev(song_points.cend()));
+    BOOST_CHECK_EQUAL(sp.min(), expected_sp.min());
+    BOOST_CHECK_EQUAL(sp.max(), expected_sp.max());
+}
+
+BOOST_AUTO_TEST_CASE(runtime_features_are_correct)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192, 192),
+                                        make_note(768)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {1}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {1}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    const ProcessedSong song {track, default_measure_mode_data(),
+                              default_guitar_pathing_settings()};
+    const auto& points = song.points();
+    const auto point_count = static_cast<std::size_t>(
+        std::distance(points.cbegin(), points.cend()));
+
+    const auto features = song.runtime_features();
+
+    BOOST_CHECK_EQUAL(features.point_count, point_count);
+    BOOST_CHECK_EQUAL(features.phrase_count, 2U);
+    BOOST_CHECK_CLOSE(features.sustain_density,
+                      static_cast<double>(point_count - 3)
+                          / static_cast<double>(point_count),
+                      0.0001);
+    BOOST_CHECK_GT(features.whammy_coverage, 0.0);
+    BOOST_CHECK_LT(features.whammy_coverage, 1.0);
+    BOOST_CHECK_GT(features.predicted_cost(),
+                   static_cast<double>(point_count * 3));
+}
+
 BOOST_AUTO_TEST_SUITE(is_drums_returns_the_correct_value)
 
 BOOST_AUTO_TEST_CASE(false_for_guitar)
@@ -2204,4 +2314,37 @@ BOOST_AUTO_TEST_CASE(average_multiplier_is_ignored_with_rb)
     BOOST_CHECK_EQUAL(track.path_summary(path), desired_path_output);
 }
 
+
+BOOST_AUTO_TEST_CASE(score_summary_leaves_out_activation_details)
+{
+    std::vector<SightRead::Note> notes {make_note(0), make_note(192),
+                                        make_note(384), make_note(576),
+                                        make_note(6144)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {192}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {384}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {6144}, .length = SightRead::Tick {50}}};
+    std::vector<SightRead::Solo> solos {{.start = SightRead::Tick {0},
+                                         .end = SightRead::Tick {50},
+                                         .value = 50}};
+    SightRead::NoteTrack note_track {
+        notes, SightRead::TrackType::FiveFret,
+        std::make_shared<SightRead::SongGlobalData>()};
+    note_track.sp_phrases(phrases);
+    note_track.solos(solos);
+    ProcessedSong track {note_track, default_measure_mode_data(),
+                         default_guitar_pathing_settings()};
+    const auto& points = track.points();
+    Path path {.activations = {{.act_start = points.cbegin() + 2,
+                                .act_end = points.cbegin() + 3}},
+               .score_boost = 100};
+
+    const char* desired_score_output = "Path: 2(+1)-ES1\n"
+                                       "No SP score: 310\n"
+                                       "Total score: 410\n"
+                                       "Average multiplier: 1.400x";
+
+    BOOST_CHECK_EQUAL(track.score_summary(path), desired_score_output);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -16,6 +16,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
+
 #include <boost/test/unit_test.hpp>
 
 #include "sp.hpp"
@@ -800,6 +802,131 @@ BOOST_AUTO_TEST_CASE(whammy_bursts_dont_drop_whammy_mid_extended_sustain)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(earliest_whammy_end_works_correctly)
+
+BOOST_AUTO_TEST_CASE(whammy_up_to_the_end_is_exactly_the_amount_asked_for)
+{
+    std::vector<SightRead::Note> notes {make_note(0, 1920), make_note(2112),
+                                        make_note(2304, 768)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {3000}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    SpData sp_data {track, default_measure_mode_data(),
+                    default_guitar_pathing_settings()};
+    const SightRead::Beat start {1.0};
+
+    for (const auto sp : {0.1, 0.2333333, 0.3, 0.45}) {
+        const auto end = sp_data.earliest_whammy_end(start, sp);
+        BOOST_CHECK_CLOSE(sp_data.available_whammy(start, end), sp, 1e-9);
+        BOOST_CHECK_LT(
+            sp_data.available_whammy(start, end - SightRead::Beat {1e-6}), sp);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(returns_start_if_no_whammy_is_needed)
+{
+    std::vector<SightRead::Note> notes {make_note(0, 1920)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {3000}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    SpData sp_data {track, default_measure_mode_data(),
+                    default_guitar_pathing_settings()};
+
+    BOOST_CHECK_EQUAL(
+        sp_data.earliest_whammy_end(SightRead::Beat {2.0}, 0.0).value(), 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(returns_infinity_if_there_is_not_enough_whammy)
+{
+    std::vector<SightRead::Note> notes {make_note(0, 1920)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {3000}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    SpData sp_data {track, default_measure_mode_data(),
+                    default_guitar_pathing_settings()};
+
+    BOOST_CHECK(std::isinf(
+        sp_data.earliest_whammy_end(SightRead::Beat {0.0}, 1.0).value()));
+}
+
+BOOST_AUTO_TEST_CASE(matches_bisection_with_overlapping_sustains)
+{
+    std::vector<SightRead::Note> notes {
+        make_note(0, 384), make_note(192, 768, SightRead::FIVE_FRET_RED),
+        make_note(768, 672), make_note(1536, 192),
+        make_note(1536, 576, SightRead::FIVE_FRET_RED)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {3000}}};
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::make_shared<SightRead::SongGlobalData>()};
+    track.sp_phrases(phrases);
+    SpData sp_data {track, default_measure_mode_data(),
+                    default_guitar_pathing_settings()};
+    const SightRead::Beat start {0.5};
+    const SightRead::Beat end {16.0};
+    const SightRead::Tick note_pos {3000};
+    const auto total_whammy = sp_data.available_whammy(start, end, note_pos);
+
+    BOOST_REQUIRE_GT(total_whammy, 0.0);
+    for (const auto fraction : {0.1, 0.3, 0.5, 0.7, 0.9}) {
+        const auto sp = fraction * total_whammy;
+        const auto direct_end
+            = sp_data.earliest_whammy_end(start, sp, note_pos);
+        const auto bisected_end
+            = bisected_whammy_end(sp_data, start, end, sp, note_pos);
+        BOOST_CHECK_SMALL((direct_end - bisected_end).value(), 0.0001);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(matches_bisection_with_fretbar_gain)
+{
+    std::vector<SightRead::Note> notes {make_note(0, 1440), make_note(1632),
+                                        make_note(1824, 960)};
+    std::vector<SightRead::StarPower> phrases {
+        {.position = SightRead::Tick {0}, .length = SightRead::Tick {50}},
+        {.position = SightRead::Tick {1824}, .length = SightRead::Tick {50}}};
+    auto global = std::make_shared<SightRead::SongGlobalData>();
+    SightRead::TempoMap tempo_map {
+        {{.position = SightRead::Tick {0}, .numerator = 6, .denominator = 8},
+         {.position = SightRead::Tick {1152},
+          .numerator = 3,
+          .denominator = 4}},
+        {{.position = SightRead::Tick {0}, .millibeats_per_minute = 120000},
+         {.position = SightRead::Tick {768}, .millibeats_per_minute = 150000}},
+        {},
+        192};
+    global->tempo_map(tempo_map);
+    SightRead::NoteTrack track {notes, SightRead::TrackType::FiveFret,
+                                std::move(global)};
+    track.sp_phrases(phrases);
+    SpDurationData duration_data {.time_map = {tempo_map, SpMode::Measure},
+                                  .od_beats = {},
+                                  .unison_phrases = {}};
+    SpData sp_data {track, duration_data, default_gh3_pathing_settings()};
+    const SightRead::Beat start {0.25};
+    const SightRead::Beat end {16.0};
+    const SightRead::Tick note_pos {3000};
+    const auto total_whammy = sp_data.available_whammy(start, end, note_pos);
+
+    BOOST_REQUIRE_GT(total_whammy, 0.0);
+    for (const auto fraction : {0.1, 0.3, 0.5, 0.7, 0.9}) {
+        const auto sp = fraction * total_whammy;
+        const auto direct_end
+            = sp_data.earliest_whammy_end(start, sp, note_pos);
+        const auto bisected_end
+            = bisected_whammy_end(sp_data, start, end, sp, note_pos);
+        BOOST_CHECK_SMALL((direct_end - bisected_end).value(), 0.0001);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(activation_end_point_works_correctly)
 
 BOOST_AUTO_TEST_CASE(works_when_sp_is_sufficient)
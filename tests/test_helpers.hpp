@@ -310,6 +310,30 @@ inline PathingSettings mid_squeeze_ch_guitar_pathing_settings()
             .drum_settings = SightRead::DrumSettings::default_settings()};
 }
 
+// The bisection to 0.0001 beats that total_available_sp_with_earliest_pos used
+// to find the earliest beat in [start, end] giving sp whammy before
+// SpData::earliest_whammy_end replaced it. Kept to check the direct search
+// against.
+inline SightRead::Beat bisected_whammy_end(const SpData& sp_data,
+                                           SightRead::Beat start,
+                                           SightRead::Beat end, double sp,
+                                           SightRead::Tick note_pos)
+{
+    const SightRead::Beat BEAT_EPSILON {0.0001};
+
+    auto first_beat = start;
+    auto last_beat = end;
+    while (last_beat - first_beat > BEAT_EPSILON) {
+        const auto mid_beat = (first_beat + last_beat) * 0.5;
+        if (sp_data.available_whammy(start, mid_beat, note_pos) < sp) {
+            first_beat = mid_beat;
+        } else {
+            last_beat = mid_beat;
+        }
+    }
+    return last_beat;
+}
+
 inline SpDurationData default_measure_mode_data()
 {
     return {.time_map = {{}, SpMode::Measure},
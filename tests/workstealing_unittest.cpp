@@ -0,0 +1,83 @@
+/*
+ * CHOpt - Star Power optimiser for Clone Hero
+ * Copyright (C) 2026 Raymond Wright
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "workstealing.hpp"
+
+BOOST_AUTO_TEST_SUITE(longest_first_scheduling)
+
+BOOST_AUTO_TEST_CASE(single_thread_runs_tasks_in_decreasing_cost_order)
+{
+    const std::vector<int> tasks {3, 1, 4, 1, 5, 9, 2, 6};
+    std::vector<int> processed;
+
+    longest_first_for_each(
+        tasks, 1, [](int task) { return static_cast<double>(task % 5); },
+        [&](int task) { processed.push_back(task); });
+
+    const std::vector<int> expected {4, 9, 3, 2, 1, 1, 6, 5};
+    BOOST_CHECK_EQUAL_COLLECTIONS(processed.cbegin(), processed.cend(),
+                                  expected.cbegin(), expected.cend());
+}
+
+BOOST_AUTO_TEST_CASE(every_task_is_processed_once_with_several_threads)
+{
+    std::vector<int> tasks;
+    for (auto i = 0; i < 100; ++i) {
+        tasks.push_back(i);
+    }
+    std::mutex mutex;
+    std::vector<int> processed;
+
+    longest_first_for_each(
+        tasks, 4, [](int task) { return static_cast<double>(task); },
+        [&](int task) {
+            const std::scoped_lock lock {mutex};
+            processed.push_back(task);
+        });
+
+    std::ranges::sort(processed);
+    BOOST_CHECK_EQUAL_COLLECTIONS(processed.cbegin(), processed.cend(),
+                                  tasks.cbegin(), tasks.cend());
+}
+
+BOOST_AUTO_TEST_CASE(exceptions_are_rethrown)
+{
+    const std::vector<int> tasks {1, 2, 3};
+    std::atomic<int> processed_count {0};
+
+    BOOST_CHECK_THROW(longest_first_for_each(
+                          tasks, 2, [](int /*task*/) { return 0.0; },
+                          [&](int task) {
+                              ++processed_count;
+                              if (task == 2) {
+                                  throw std::runtime_error("Task failed");
+                              }
+                          }),
+                      std::runtime_error);
+    BOOST_CHECK_LE(processed_count.load(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()